@@ -212,6 +212,7 @@ ArgDescriptor argDescriptors[] = {
   { "xicsinput", ArgFalse, (void *) &appData.icsInputBox, FALSE, INVALID },
   { "cmail", ArgString, (void *) &appData.cmailGameName, FALSE, (ArgIniType) "" },
   { "soundProgram", ArgFilename, (void *) &appData.soundProgram, XBOARD, (ArgIniType) "play" },
+  { "soundDevice", ArgString, (void *) &appData.soundDevice, XBOARD, (ArgIniType) "" },
   { "fontSizeTolerance", ArgInt, (void *) &appData.fontSizeTolerance, XBOARD, (ArgIniType) 4 },
   { "lowTimeWarningColor", ArgColor, (void *) 6, XBOARD, (ArgIniType) LOWTIMEWARNING_COLOR },
   { "lowTimeWarning", ArgBoolean, (void *) &appData.lowTimeWarning, XBOARD, (ArgIniType) FALSE },
@@ -237,6 +238,14 @@ ArgDescriptor argDescriptors[] = {
   { "ruser", ArgString, (void *) &appData.remoteUser, FALSE, INVALID },
   { "timeDelay", ArgFloat, (void *) &appData.timeDelay, TRUE, INVALID },
   { "td", ArgFloat, (void *) &appData.timeDelay, FALSE, INVALID },
+  { "annotateFile", ArgFilename, (void *) &appData.annotateFile, FALSE, (ArgIniType) "" },
+  { "annotateEngines", ArgInt, (void *) &appData.annotateEngines, TRUE, (ArgIniType) 2 },
+  { "annotateDepth", ArgInt, (void *) &appData.annotateDepth, TRUE, (ArgIniType) 0 },
+  { "annotateTime", ArgInt, (void *) &appData.annotateTime, TRUE, (ArgIniType) 0 },
+  { "annotateNodes", ArgInt, (void *) &appData.annotateNodes, TRUE, (ArgIniType) 0 },
+  { "analysisCache", ArgFilename, (void *) &appData.analysisCache, TRUE, (ArgIniType) "" },
+  { "analysisCacheSize", ArgInt, (void *) &appData.analysisCacheSize, TRUE, (ArgIniType) 64 },
+  { "analysisCacheDepth", ArgInt, (void *) &appData.analysisCacheDepth, TRUE, (ArgIniType) 12 },
   { "timeControl", ArgString, (void *) &appData.timeControl, TRUE, (ArgIniType) TIME_CONTROL },
   { "tc", ArgString, (void *) &appData.timeControl, FALSE, INVALID },
   { "timeIncrement", ArgFloat, (void *) &appData.timeIncrement, FALSE, INVALID },
@@ -275,6 +284,8 @@ ArgDescriptor argDescriptors[] = {
   { "lgi", ArgInt, (void *) &appData.loadGameIndex, FALSE, INVALID },
   { "saveGameFile", ArgFilename, (void *) &appData.saveGameFile, TRUE, (ArgIniType) "" },
   { "sgf", ArgFilename, (void *) &appData.saveGameFile, FALSE, INVALID },
+  { "atomicSave", ArgBoolean, (void *) &appData.atomicSave, TRUE, (ArgIniType) FALSE },
+  { "saveShards", ArgBoolean, (void *) &appData.saveShards, TRUE, (ArgIniType) FALSE },
   { "autoSaveGames", ArgBoolean, (void *) &appData.autoSaveGames, TRUE, (ArgIniType) FALSE },
   { "autosave", ArgTrue, (void *) &appData.autoSaveGames, FALSE, INVALID },
   { "xautosave", ArgFalse, (void *) &appData.autoSaveGames, FALSE, INVALID },
@@ -638,6 +649,11 @@ ArgDescriptor argDescriptors[] = {
   { "holdingsSize", ArgInt, (void *) &appData.holdingsSize, FALSE, (ArgIniType) -1 },
   { "defaultMatchGames", ArgInt, (void *) &appData.defaultMatchGames, TRUE, (ArgIniType) 10 },
   { "matchPause", ArgInt, (void *) &appData.matchPause, TRUE, (ArgIniType) 10000 },
+  { "sprtElo0", ArgFloat, (void *) &appData.sprtElo0, TRUE, INVALID },
+  { "sprtElo1", ArgFloat, (void *) &appData.sprtElo1, TRUE, INVALID },
+  { "sprtAlpha", ArgFloat, (void *) &appData.sprtAlpha, TRUE, INVALID },
+  { "sprtBeta", ArgFloat, (void *) &appData.sprtBeta, TRUE, INVALID },
+  { "sprtStop", ArgBoolean, (void *) &appData.sprtStop, TRUE, (ArgIniType) FALSE },
   { "pieceToCharTable", ArgString, (void *) &appData.pieceToCharTable, FALSE, INVALID },
   { "pieceNickNames", ArgString, (void *) &appData.pieceNickNames, FALSE, INVALID },
   { "colorNickNames", ArgString, (void *) &appData.colorNickNames, FALSE, INVALID },
@@ -650,9 +666,12 @@ ArgDescriptor argDescriptors[] = {
   { "checkMates", ArgBoolean, (void *) &appData.checkMates, TRUE, (ArgIniType) FALSE },
   { "materialDraws", ArgBoolean, (void *) &appData.materialDraws, TRUE, (ArgIniType) FALSE },
   { "trivialDraws", ArgBoolean, (void *) &appData.trivialDraws, TRUE, (ArgIniType) FALSE },
+  { "adjudicateTablebases", ArgBoolean, (void *) &appData.adjudicateTablebases, TRUE, (ArgIniType) FALSE },
+  { "explorerDepth", ArgInt, (void *) &appData.explorerDepth, TRUE, (ArgIniType) 20 },
   { "ruleMoves", ArgInt, (void *) &appData.ruleMoves, TRUE, (ArgIniType) 51 },
   { "repeatsToDraw", ArgInt, (void *) &appData.drawRepeats, TRUE, (ArgIniType) 6 },
   { "backgroundObserve", ArgBoolean, (void *) &appData.bgObserve, TRUE, (ArgIniType) FALSE },
+  { "observeSaveFile", ArgFilename, (void *) &appData.observeSaveFile, TRUE, (ArgIniType) "" },
   { "dualBoard", ArgBoolean, (void *) &appData.dualBoard, TRUE, (ArgIniType) FALSE },
   { "autoKibitz", ArgTrue, (void *) &appData.autoKibitz, FALSE, INVALID },
   { "engineDebugOutput", ArgInt, (void *) &appData.engineComments, FALSE, (ArgIniType) 1 },
@@ -759,6 +778,7 @@ ArgDescriptor argDescriptors[] = {
   { "serverFile", ArgString, (void *) &appData.serverFileName, FALSE, (ArgIniType) NULL },
   { "suppressLoadMoves", ArgBoolean, (void *) &appData.suppressLoadMoves, FALSE, (ArgIniType) FALSE },
   { "serverPause", ArgInt, (void *) &appData.serverPause, FALSE, (ArgIniType) 15 },
+  { "creditGuiLag", ArgBoolean, (void *) &appData.creditGuiLag, TRUE, (ArgIniType) FALSE },
   { "firstTimeOdds", ArgInt, (void *) &appData.firstTimeOdds, FALSE, (ArgIniType) 1 },
   { "secondTimeOdds", ArgInt, (void *) &appData.secondTimeOdds, FALSE, (ArgIniType) 1 },
   { "timeOddsMode", ArgInt, (void *) &appData.timeOddsMode, TRUE, INVALID },
@@ -861,9 +881,7 @@ AppendToSettingsFile (char *line)
     // line did not occur; add it
     fclose(f);
     if(f = fopen(SETTINGS_FILE, "a")) {
-      TimeMark now;
-      GetTimeMark(&now);
-      fprintf(f, "-date %10lu\n%s\n", now.sec, line);
+      fprintf(f, "-date %10lu\n%s\n", (unsigned long) time(NULL), line); // date, so not from (monotonic) GetTimeMark
       fclose(f);
     }
   }
@@ -885,6 +903,13 @@ StringGet(void *getClosure)
   return *((*p)++);
 }
 
+char
+BufferGet(void *getClosure)
+{ // same as StringGet, but for contents of a file, so that unknown options are not fatal
+  char **p = (char **) getClosure;
+  return *((*p)++);
+}
+
 char
 FileGet(void *getClosure)
 {
@@ -937,7 +962,7 @@ ParseSettingsFile(char *name, char **addr)
       if (addr != NULL) {
 	    ASSIGN(*addr, fullname);
       }
-      ParseArgs(FileGet, f);
+      ParseArgsFromFile(f);
       fclose(f);
       return TRUE;
     }
@@ -945,6 +970,40 @@ ParseSettingsFile(char *name, char **addr)
   return FALSE;
 }
 
+#define ARG_HASH_SIZE 2048 /* power of 2, well above twice the number of options */
+
+static short argHash[ARG_HASH_SIZE]; // index+1 in argDescriptors
+static int argHashBuilt;
+
+static unsigned int
+HashArgName(char *name)
+{
+  unsigned int h = 0;
+  while(*name) h = 33*h + (unsigned char) *name++;
+  return h;
+}
+
+ArgDescriptor *
+LookupArg(char *name)
+{ // find option with given name through hash table (built on first call)
+  unsigned int h;
+  ArgDescriptor *ad;
+
+  if(!argHashBuilt) { // first time: hash all names; first occurrence of a name wins
+    argHashBuilt = TRUE;
+    for (ad = argDescriptors; ad->argName != NULL; ad++) {
+      for(h = HashArgName(ad->argName); argHash[h & (ARG_HASH_SIZE-1)] > 0; h++)
+	if(strcmp(argDescriptors[argHash[h & (ARG_HASH_SIZE-1)]-1].argName, ad->argName) == 0) break;
+      if(argHash[h & (ARG_HASH_SIZE-1)] == 0) argHash[h & (ARG_HASH_SIZE-1)] = ad - argDescriptors + 1;
+    }
+  }
+  for(h = HashArgName(name); argHash[h & (ARG_HASH_SIZE-1)] > 0; h++) {
+    ad = &argDescriptors[argHash[h & (ARG_HASH_SIZE-1)]-1];
+    if(strcmp(ad->argName, name) == 0) return ad;
+  }
+  return NULL;
+}
+
 void
 ParseArgs(GetFunc get, void *cl)
 {
@@ -976,11 +1035,9 @@ ParseArgs(GetFunc get, void *cl)
 	ch = get(cl);
       }
       *q = NULLCHAR;
-      for (ad = argDescriptors; ad->argName != NULL; ad++)
-	if (strcmp(ad->argName, argName + 1) == 0) break;
-      if (ad->argName == NULL) {
+      if ((ad = LookupArg(argName + 1)) == NULL) {
 	char endChar = (ch && ch != '\n' && (ch = get(cl)) == '{' ? '}' : '\n');
-	ExitArgError(_("Unrecognized argument %s"), argName, get != &FileGet); // [HGM] make unknown argument non-fatal
+	ExitArgError(_("Unrecognized argument %s"), argName, get != &FileGet && get != &BufferGet); // [HGM] make unknown argument non-fatal
 	while (ch != endChar && ch != NULLCHAR) ch = get(cl); // but skip rest of line it is on (or until closing '}' )
 	if(ch == '}') ch = get(cl);
 	continue; // so that when it is in a settings file, it is the only setting that will be purged from it
@@ -1256,10 +1313,32 @@ ParseArgsFromString(char *p)
     ParseArgs(StringGet, &p);
 }
 
+static char *
+ReadArgsFile(FILE *f)
+{ // read (rest of) file in one go, dropping the '\r' of DOS line endings; returns malloc'ed string, or NULL
+    char *buf = NULL, *p, *q;
+    size_t len = 0, size = 0, n;
+    do {
+	if(len + 4096 >= size) {
+	    char *b = realloc(buf, size += 16384);
+	    if(b == NULL) { free(buf); return NULL; }
+	    buf = b;
+	}
+	len += n = fread(buf + len, 1, size - len - 1, f);
+    } while(n > 0);
+    buf[len] = NULLCHAR;
+    for(p = q = buf; *p; p++) if(*p != '\r') *q++ = *p;
+    *q = NULLCHAR;
+    return buf;
+}
+
 void
 ParseArgsFromFile(FILE *f)
 {
-    ParseArgs(FileGet, f);
+    char *buf = ReadArgsFile(f), *p = buf;
+    if(buf == NULL) { ParseArgs(FileGet, f); return; } // out of memory; read char by char
+    ParseArgs(BufferGet, &p);
+    free(buf);
 }
 
 void
@@ -1386,6 +1465,8 @@ InitAppData(char *lpCmdLine)
   // float: casting to int is not harmless, so default cannot be contained in table
   appData.timeDelay = TIME_DELAY;
   appData.timeIncrement = -314159;
+  appData.sprtElo0 = 0.; appData.sprtElo1 = 5.;
+  appData.sprtAlpha = appData.sprtBeta = 0.05;
 
   // some complex, platform-dependent stuff that could not be handled from table
   SetDefaultTextAttribs();
@@ -1512,11 +1593,10 @@ SaveSettings(char* name)
   ArgDescriptor *ad;
   char dir[MSG_SIZ], buf[MSG_SIZ];
   int mps = appData.movesPerSession;
-  TimeMark now;
 
   if (!MainWindowUp() && !autoClose) return;
 
-  GetTimeMark(&now); saveDate = now.sec;
+  saveDate = time(NULL);
 
   GetCurrentDirectory(MSG_SIZ, dir);
   if(MySearchPath(installDir, name, buf)) {
@@ -1656,10 +1736,7 @@ GetArgValue(char *name)
   ArgDescriptor *ad;
   int len;
 
-  for (ad = argDescriptors; ad->argName != NULL; ad++)
-    if (strcmp(ad->argName, name) == 0) break;
-
-  if (ad->argName == NULL) return FALSE;
+  if ((ad = LookupArg(name)) == NULL) return FALSE;
 
   switch(ad->argType) {
     case ArgString:
@@ -64,6 +64,7 @@
 #   else
 #       define EGBB_NAME "egbbdll.dll"
 #   endif
+#   define SYZYGY_NAME "fathom.dll"
 
 #else
 
@@ -76,6 +77,7 @@
 #   else
 #       define EGBB_NAME "egbbso.so"
 #   endif
+#   define SYZYGY_NAME "libfathom.so"
     // kludge to allow Windows code in back-end by converting it to corresponding Linux code 
 #   define CDECL
 #   define HMODULE void *
@@ -138,6 +140,19 @@ extern int gettimeofday(struct timeval *, struct timezone *);
 # include <unistd.h>
 #endif
 
+#if HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+  /* atomic operations on memory shared with other instances through a mapped file */
+# define AtomicAdd(p, n) __sync_fetch_and_add(p, n)
+# define AtomicSwap(p, old, new) __sync_bool_compare_and_swap(p, old, new)
+# define AtomicFence() __sync_synchronize()
+#else
+  /* no mapped files, so nothing is shared, and plain operations will do */
+# define AtomicAdd(p, n) (*(p) += (n))
+# define AtomicSwap(p, old, new) (*(p) == (old) ? (*(p) = (new), 1) : 0)
+# define AtomicFence()
+#endif
+
 #include "common.h"
 #include "frontend.h"
 #include "backend.h"
@@ -149,6 +164,7 @@ extern int gettimeofday(struct timeval *, struct timezone *);
 #include "backendz.h"
 #include "evalgraph.h"
 #include "engineoutput.h"
+#include "matchstats.h"
 #include "gettext.h"
 
 #ifdef ENABLE_NLS
@@ -232,6 +248,7 @@ void ParseFeatures P((char* args, ChessProgramState *cps));
 void InitBackEnd3 P((void));
 void FeatureDone P((ChessProgramState* cps, int val));
 void InitChessProgram P((ChessProgramState *cps, int setup));
+void SendProgramStatsToFrontend P((ChessProgramState *cps, ChessProgramStats *cpstats));
 void OutputKibitz(int window, char *text);
 int PerpetualChase(int first, int last);
 int EngineOutputIsUp();
@@ -240,11 +257,24 @@ void NextMatchGame P((void));
 int NextTourneyGame P((int nr, int *swap));
 int Pairing P((int nr, int nPlayers, int *w, int *b, int *sync));
 FILE *WriteTourneyFile P((char *results, FILE *f));
+void SaveStandings P((void));
 void DisplayTwoMachinesTitle P(());
 static void ExcludeClick P((int index));
 void ToggleSecond P((void));
 void PauseEngine P((ChessProgramState *cps));
 static int NonStandardBoardSize P((VariantClass v, int w, int h, int s));
+static int GrowGameStorage P((int needed));
+static void AnnotateStop P((char *message));
+static void ObservedGameEnds P((int gamenum, char *why, char *result));
+static void PreloadOpenings P((void));
+static int LoadCachedOpening P((char *file, int n, int game));
+static int StartFromPosition P((Board initial_position, int positionNumber, char *title));
+static int EgtProbe P((int moveNr, int *dtz));
+static int ReversiblePlies P((int moveNr));
+static void RecordOpeningMove P((int fromX, int fromY, int toX, int toY, int promoChar));
+static void ObservedGameHistory P((int gamenum));
+static void ForgetObservedGame P((int gamenum));
+static int nrOfObserved; // entries in table of observed ICS games
 
 #ifdef WIN32
        extern void ConsoleCreate();
@@ -474,9 +504,9 @@ long ics_clock_paused = 0;
 ProcRef icsPR = NoProc, cmailPR = NoProc;
 InputSourceRef telnetISR = NULL, fromUserISR = NULL, cmailISR = NULL;
 GameMode gameMode = BeginningOfGame;
-char moveList[MAX_MOVES][MOVE_LEN], parseList[MAX_MOVES][MOVE_LEN * 2];
-char *commentList[MAX_MOVES], *cmailCommentList[CMAIL_MAX_GAMES];
-ChessProgramStats_Move pvInfoList[MAX_MOVES]; /* [AS] Info about engine thinking */
+char (*moveList)[MOVE_LEN], (*parseList)[MOVE_LEN * 2];
+char **commentList, *cmailCommentList[CMAIL_MAX_GAMES];
+ChessProgramStats_Move *pvInfoList; /* [AS] Info about engine thinking */
 int hiddenThinkOutputState = 0; /* [AS] */
 int adjudicateLossThreshold = 0; /* [AS] Automatic adjudication */
 int adjudicateLossPlies = 6;
@@ -492,10 +522,22 @@ long whiteTimeRemaining, blackTimeRemaining, timeControl, timeIncrement, lastWhi
 Boolean adjustedClock;
 long timeControl_2; /* [AS] Allow separate time controls */
 char *fullTimeControlString = NULL, *nextSession, *whiteTC, *blackTC, activePartner; /* [HGM] secondary TC: merge of MPS, TC and inc */
-long timeRemaining[2][MAX_MOVES];
+long *timeRemaining[2];
 int matchGame = 0, nextGame = 0, roundNr = 0;
 Boolean waitingForGame = FALSE, startingEngine = FALSE;
 TimeMark programStartTime, pauseStart;
+
+/* lag: GUI-side overhead in handling engine moves, accumulated per game and color */
+typedef struct {
+    int moves, relays;
+    double stopSum, stopMax;   /* usec from reading the move to stopping the engine's clock */
+    double relaySum, relayMax; /* usec from reading the move to relaying it to the opponent */
+    long credited;             /* msec given back to the engine's clock */
+} LagStats;
+
+LagStats lagStats[2];
+static TimeMark lineReadTM;   /* when ReceiveFromProgram got the line being handled */
+static ChessProgramState *lineReader, *lagMover;
 char ics_handle[MSG_SIZ];
 int have_set_title = 0;
 
@@ -510,7 +552,9 @@ GameInfo gameInfo;
 
 AppData appData;
 
-Board boards[MAX_MOVES];
+Board *boards;
+int maxMoves; // size of the arrays boards, moveList, parseList, commentList, pvInfoList and timeRemaining
+static Boolean gameStorageMoved; // set when the arrays were moved since the last HistorySet()
 /* [HGM] Following 7 needed for accurate legality tests: */
 signed char  castlingRank[BOARD_FILES]; // and corresponding ranks
 signed char  initialRights[BOARD_FILES];
@@ -523,7 +567,7 @@ int mute; // mute all sounds
 
 // [HGM] vari: next 12 to save and restore variations
 #define MAX_VARIATIONS 10
-int framePtr = MAX_MOVES-1; // points to free stack entry
+int framePtr = -1; // points to free stack entry
 int storedGames = 0;
 int savedFirst[MAX_VARIATIONS];
 int savedLast[MAX_VARIATIONS];
@@ -531,9 +575,9 @@ int savedFramePtr[MAX_VARIATIONS];
 char *savedDetails[MAX_VARIATIONS];
 ChessMove savedResult[MAX_VARIATIONS];
 
-void PushTail P((int firstMove, int lastMove));
+Boolean PushTail P((int firstMove, int lastMove));
 Boolean PopTail P((Boolean annotate));
-void PushInner P((int firstMove, int lastMove));
+Boolean PushInner P((int firstMove, int lastMove));
 void PopInner P((Boolean annotate));
 void CleanupTail P((void));
 
@@ -1123,6 +1167,7 @@ InitBackEnd1 ()
     {
         int i, j;
 
+        GrowGameStorage(0); // allocate initial game record
         for( i=0; i<=framePtr; i++ ) {
             pvInfoList[i].depth = -1;
             boards[i][EP_STATUS] = EP_NONE;
@@ -1468,17 +1513,18 @@ CalculateIndex (int index, int gameNr)
 int
 LoadGameOrPosition (int gameNr)
 {   // [HGM] taken out of MatchEvent and NextMatchGame (to combine it)
+    int n;
     if (*appData.loadGameFile != NULLCHAR) {
-	if (!LoadGameFromFile(appData.loadGameFile,
-		CalculateIndex(appData.loadGameIndex, gameNr),
-			      appData.loadGameFile, FALSE)) {
+	n = CalculateIndex(appData.loadGameIndex, gameNr);
+	if (!LoadCachedOpening(appData.loadGameFile, n, TRUE) &&
+	    !LoadGameFromFile(appData.loadGameFile, n, appData.loadGameFile, FALSE)) {
 	    DisplayFatalError(_("Bad game file"), 0, 1);
 	    return 0;
 	}
     } else if (*appData.loadPositionFile != NULLCHAR) {
-	if (!LoadPositionFromFile(appData.loadPositionFile,
-		CalculateIndex(appData.loadPositionIndex, gameNr),
-				  appData.loadPositionFile)) {
+	n = CalculateIndex(appData.loadPositionIndex, gameNr);
+	if (!LoadCachedOpening(appData.loadPositionFile, n, FALSE) &&
+	    !LoadPositionFromFile(appData.loadPositionFile, n, appData.loadPositionFile)) {
 	    DisplayFatalError(_("Bad position file"), 0, 1);
 	    return 0;
 	}
@@ -1486,16 +1532,312 @@ LoadGameOrPosition (int gameNr)
     return 1;
 }
 
+/* Tourney results are also kept in a binary side file "<tourneyFile>.slots", which all instances
+   playing the tourney map in memory. Each game has a one-byte slot there (with the same encoding as
+   in the -results string), which is claimed by an atomic compare-and-swap. This way picking the next
+   game needs no locking or re-parsing of the tourney file, and waiting instances can be woken up by
+   watching the side file. The human-readable tourney file is then only rewritten every so often.
+*/
+#define SLOTS_MAGIC "XBslots1"
+#define SLOTS_SYNC  16 /* results after which the tourney file is brought up to date */
+
+typedef struct {
+    char magic[8];
+    int size;  /* number of game slots */
+    int done;  /* number of results recorded so far */
+    int touch; /* dummy, written to notify watchers */
+} SlotHeader;
+
+static SlotHeader *slotHeader;
+static char *slots, *slotName;
+static int slotFile = -1, slotCount, waitInterval;
+static InputSourceRef slotWatch;
+static ProcRef slotWatchProc;
+
+static void
+UnmapTourneySlots ()
+{
+#if HAVE_SYS_MMAN_H
+    if(slots) munmap((void *) slotHeader, sizeof(SlotHeader) + slotCount);
+    if(slotFile >= 0) close(slotFile);
+    if(slotWatch) RemoveInputSource(slotWatch), DestroyChildProcess(slotWatchProc, 0);
+#endif
+    slotHeader = NULL; slots = NULL; slotFile = -1; slotWatch = NULL;
+}
+
+static int
+MapTourneySlots ()
+{   // map the slots file of the current tourney in memory, creating or growing it from -results as needed
+#if HAVE_SYS_MMAN_H
+    SlotHeader h;
+    char buf[MSG_SIZ], *map;
+    int fd, i, size = appData.matchGames + 2, len = strlen(appData.results);
+    if(!appData.tourneyFile[0]) return 0;
+    snprintf(buf, MSG_SIZ, "%s.slots", appData.tourneyFile);
+    if(slots && slotCount >= size && !strcmp(buf, slotName)) return 1; // we already have it
+    UnmapTourneySlots();
+    if((fd = open(buf, O_RDWR | O_CREAT, 0666)) < 0) return 0;
+    flock(fd, LOCK_EX); // only creation and growth must be serialized
+    if(read(fd, &h, sizeof(h)) != sizeof(h) || strncmp(h.magic, SLOTS_MAGIC, 8)) { // new file
+	memset(&h, 0, sizeof(h)); memcpy(h.magic, SLOTS_MAGIC, 8);
+	for(i=0; i<len; i++) if(appData.results[i] != ' ') h.done++;
+    } else len = 0; // existing file is authoritative
+    if(h.size < size) { // (re)initialize new slots, from the -results string if the file is new
+	for(i=h.size; i<size; i++) buf[0] = (i < len ? appData.results[i] : ' '), pwrite(fd, buf, 1, sizeof(h) + i);
+	h.size = size;
+	pwrite(fd, &h, sizeof(h), 0);
+    }
+    map = mmap(NULL, sizeof(h) + h.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    flock(fd, LOCK_UN);
+    if(map == MAP_FAILED) { close(fd); return 0; }
+    snprintf(buf, MSG_SIZ, "%s.slots", appData.tourneyFile);
+    ASSIGN(slotName, buf);
+    slotFile = fd; slotCount = h.size;
+    slotHeader = (SlotHeader *) map; slots = map + sizeof(h);
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+static void
+SlotsToResults ()
+{   // make -results string reflect the slots (without trailing unplayed games)
+    int n = appData.matchGames + 1;
+    if(!slots) return;
+    if(n > slotCount) n = slotCount;
+    while(n > 0 && slots[n-1] == ' ') n--;
+    FREE(appData.results);
+    appData.results = malloc(n + 1);
+    memcpy(appData.results, slots, n); appData.results[n] = NULLCHAR;
+}
+
+static int
+FirstBusySlot ()
+{   // number of first game that is not finished
+    int i;
+    for(i=0; i<slotCount; i++) if(slots[i] == '*' || slots[i] == ' ') break;
+    return i;
+}
+
+static void
+FlushTourneySlots ()
+{   // bring the results in the human-readable tourney file up to date
+    FILE *f = fopen(appData.tourneyFile, "r+");
+    if(f == NULL) return;
+    flock(fileno(f), LOCK_EX);
+    ParseArgsFromFile(f); // do not lose changes made by others (e.g. substitutions)
+    SlotsToResults();
+    fseek(f, 0, SEEK_SET);
+    WriteTourneyFile(appData.results, f);
+#if HAVE_SYS_MMAN_H
+    fflush(f); ftruncate(fileno(f), ftell(f));
+#endif
+    fclose(f); // releases lock
+}
+
+static void
+ReserveSlot (int gameNr, char resChar)
+{   // lock-free equivalent of the tourney-file manipulation in ReserveGame
+    int i, n = appData.matchGames + 1, claim = (resChar != ' ' && !abortMatch);
+    if(n > slotCount) n = slotCount;
+    if(gameNr >= 0 && gameNr < slotCount) {
+	slots[gameNr] = resChar;
+	if(resChar != ' ') AtomicAdd(&slotHeader->done, 1);
+    }
+    for(i=0; i<n; i++) if(slots[i] == ' ' && (!claim || AtomicSwap(slots + i, ' ', '*'))) break;
+    nextGame = i; // when claim failed, another instance just took this one, and we try the next
+    SlotsToResults();
+    if(appData.debugMode) fprintf(debugFP, "pick next game from slots '%s': %d\n", appData.results, nextGame);
+#if HAVE_SYS_MMAN_H
+    pwrite(slotFile, &i, sizeof(int), (char *) &slotHeader->touch - (char *) slotHeader); // wakes up instances that watch file
+#endif
+    if(gameNr >= 0 && (slotHeader->done % SLOTS_SYNC == 0 || nextGame > appData.matchGames || !claim))
+	FlushTourneySlots();
+}
+
+static void
+SlotsChanged (InputSourceRef isr, VOIDSTAR closure, char *buf, int count, int error)
+{   // input callback of watch on the slots file
+    if(count <= 0) { RemoveInputSource(isr); DestroyChildProcess(slotWatchProc, 0); slotWatch = NULL; }
+    if(waitingForGame) ScheduleDelayedEvent(NextMatchGame, count <= 0 ? 1000 : 10);
+}
+
+static void
+WaitForTourneyChange ()
+{   // arrange NextMatchGame to be called again when other instances might have finished their game
+#if HAVE_SYS_MMAN_H
+    if(slots && !slotWatch && OpenFileWatch(slotName, &slotWatchProc) == 0)
+	slotWatch = AddInputSource(slotWatchProc, FALSE, SlotsChanged, NULL);
+    if(slotWatch) return;
+#endif
+    ScheduleDelayedEvent(NextMatchGame, 1000); // no watch possible; poll
+}
+
+/* Analysis results are kept in a memory-mapped file shared by all instances, so that positions
+   that were analyzed before (by this or another instance, in this or an earlier session) can be
+   shown at once. Entries are keyed by the book hash of the position combined with the engine
+   command, and are grouped in buckets where the shallowest entry is replaced. Each entry has a
+   sequence number that is odd while it is being written, so readers can detect torn copies.
+*/
+#define ACACHE_MAGIC "XBcache1"
+#define ACACHE_WAYS  4
+
+typedef struct {
+    char magic[8];
+    int size;  /* number of entries */
+    int dummy;
+} CacheHeader;
+
+typedef struct {
+    u64 key;
+    u64 nodes;
+    int seq;
+    int depth, score, time;
+    char pv[224];
+} CacheEntry;
+
+static CacheEntry *cacheEntries;
+static int cacheCount = -1; /* -1 = not tried yet, 0 = no cache */
+static u64 analysisKey;     /* position the engine is analyzing */
+static TimeMark analysisStart;
+
+static int
+MapAnalysisCache ()
+{
+#if HAVE_SYS_MMAN_H
+    CacheHeader h;
+    struct stat st;
+    char *map;
+    int fd;
+    if(cacheCount >= 0) return cacheCount;
+    cacheCount = 0;
+    if(!*appData.analysisCache) return 0;
+    if((fd = open(appData.analysisCache, O_RDWR | O_CREAT, 0666)) < 0) return 0;
+    flock(fd, LOCK_EX); // only creation must be serialized
+    if(read(fd, &h, sizeof(h)) != sizeof(h) || strncmp(h.magic, ACACHE_MAGIC, 8) || h.size < ACACHE_WAYS ||
+       fstat(fd, &st) || st.st_size < sizeof(h) + (off_t) h.size * sizeof(CacheEntry)) { // new, truncated or foreign file
+	memset(&h, 0, sizeof(h)); memcpy(h.magic, ACACHE_MAGIC, 8);
+	h.size = ((appData.analysisCacheSize > 0 ? appData.analysisCacheSize : 1) << 20) / sizeof(CacheEntry) & ~(ACACHE_WAYS-1);
+	if(ftruncate(fd, sizeof(h) + (off_t) h.size * sizeof(CacheEntry)) || pwrite(fd, &h, sizeof(h), 0) != sizeof(h)) h.size = 0;
+    } // else existing file is authoritative
+    map = h.size ? mmap(NULL, sizeof(h) + (size_t) h.size * sizeof(CacheEntry), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    flock(fd, LOCK_UN);
+    close(fd); // mapping stays valid
+    if(map == MAP_FAILED) return 0;
+    cacheEntries = (CacheEntry *) (map + sizeof(h));
+    cacheCount = h.size;
+#else
+    cacheCount = 0;
+#endif
+    return cacheCount;
+}
+
+static u64
+AnalysisKey (int moveNr)
+{   // position key combined with the engine that analyzes it
+    u64 key = PositionKey(moveNr);
+    char *p = first.program;
+    while(*p) key = (key ^ (unsigned char) *p++) * u64Const(0x100000001b3);
+    return key ? key : 1;
+}
+
+static int
+ProbeCache (u64 key, CacheEntry *res)
+{
+    volatile CacheEntry *e;
+    int i, seq;
+    if(!MapAnalysisCache()) return FALSE;
+    e = cacheEntries + (key % (cacheCount / ACACHE_WAYS)) * ACACHE_WAYS;
+    for(i=0; i<ACACHE_WAYS; i++, e++) {
+	seq = e->seq;
+	if((seq & 1) || e->key != key) continue;
+	AtomicFence();
+	memcpy(res, (void *) e, sizeof(CacheEntry));
+	AtomicFence();
+	if(e->seq == seq && res->key == key && res->depth > 0) return TRUE; // else it was overwritten while we copied
+    }
+    return FALSE;
+}
+
+static void
+StoreCache (u64 key, int depth, int score, int time, u64 nodes, char *pv)
+{
+    CacheEntry *e, *victim;
+    int i, seq;
+    if(!MapAnalysisCache() || depth <= 0) return;
+    victim = e = cacheEntries + (key % (cacheCount / ACACHE_WAYS)) * ACACHE_WAYS;
+    for(i=0; i<ACACHE_WAYS; i++, e++) {
+	if(e->key == key) { if(e->depth > depth) return; victim = e; break; } // never replace deeper result
+	if(e->depth < victim->depth) victim = e;
+    }
+    seq = victim->seq;
+    if((seq & 1) || !AtomicSwap(&victim->seq, seq, seq + 1)) return; // other instance is writing it
+    victim->key = key; victim->depth = depth; victim->score = score;
+    victim->time = time; victim->nodes = nodes;
+    safeStrCpy(victim->pv, pv ? pv : "", sizeof(victim->pv));
+    AtomicFence();
+    victim->seq = seq + 2;
+}
+
+static void
+CacheAnalysis (int moveNr, ChessProgramStats *stats)
+{   // store thinking output of the analyzing engine
+    TimeMark now;
+    u64 key;
+    if(!MapAnalysisCache()) return;
+    key = AnalysisKey(moveNr);
+    GetTimeMark(&now);
+    if(key != analysisKey) analysisKey = key, analysisStart = now; // position changed without us noticing
+    // a search that took longer than we are in this position must be late output for the previous one
+    if(10*stats->time > SubtractTimeMarks(&now, &analysisStart) + 50) return;
+    StoreCache(key, stats->depth, stats->score, stats->time, stats->nodes, stats->movelist);
+}
+
+static int
+ShowCachedAnalysis ()
+{   // called when the analyzed position changes: show at once what is known about it
+    CacheEntry e;
+    if(gameMode != AnalyzeMode && gameMode != AnalyzeFile || !MapAnalysisCache()) return FALSE;
+    analysisKey = AnalysisKey(currentMove); GetTimeMark(&analysisStart);
+    if(!ProbeCache(analysisKey, &e) || e.depth < appData.analysisCacheDepth) return FALSE;
+    programStats.depth = e.depth;
+    programStats.score = e.score;
+    programStats.time  = e.time;
+    programStats.nodes = e.nodes;
+    programStats.got_only_move = programStats.line_is_book = 0;
+    programStats.nr_moves = programStats.moves_left = 0;
+    safeStrCpy(programStats.movelist, e.pv, sizeof(programStats.movelist));
+    SendProgramStatsToFrontend(&first, &programStats);
+    return TRUE;
+}
+
+static u64 tourneySignature; // hash of the tourney-file contents as last parsed; 0 when options might deviate from them
+
+static void
+ParseTourneyFile (FILE *f)
+{   // parse the (open) tourney file, unless it is unchanged since last time, and nothing changed the options it sets
+    u64 h = u64Const(0xcbf29ce484222325);
+    int c;
+    while((c = getc(f)) != EOF) h = (h ^ c) * u64Const(0x100000001b3); // FNV-1a over the raw contents
+    h |= 1; // never 0
+    if(h == tourneySignature) return;
+    rewind(f);
+    ParseArgsFromFile(f);
+    tourneySignature = h;
+}
+
 void
 ReserveGame (int gameNr, char resChar)
 {
-    FILE *tf = fopen(appData.tourneyFile, "r+");
+    FILE *tf;
     char *p, *q, c, buf[MSG_SIZ];
-    if(tf == NULL) { nextGame = appData.matchGames + 1; return; } // kludge to terminate match
+    if(MapTourneySlots()) ReserveSlot(gameNr, resChar); else {
+    if((tf = fopen(appData.tourneyFile, "r+")) == NULL) { nextGame = appData.matchGames + 1; return; } // kludge to terminate match
     safeStrCpy(buf, lastMsg, MSG_SIZ);
     DisplayMessage(_("Pick new game"), "");
     flock(fileno(tf), LOCK_EX); // lock the tourney file while we are messing with it
-    ParseArgsFromFile(tf);
+    ParseTourneyFile(tf);
     p = q = appData.results;
     if(appData.debugMode) {
       char *r = appData.participants;
@@ -1521,6 +1863,7 @@ ReserveGame (int gameNr, char resChar)
     fprintf(tf, "%s\"\n", q); fclose(tf); // update, and flush by closing
     DisplayMessage(buf, "");
     free(p); appData.results = q;
+    }
     if(nextGame <= appData.matchGames && resChar != ' ' && !abortMatch &&
        (gameNr < 0 || nextGame / appData.defaultMatchGames != gameNr / appData.defaultMatchGames)) {
       int round = appData.defaultMatchGames * appData.tourneyType;
@@ -1529,6 +1872,7 @@ ReserveGame (int gameNr, char resChar)
 	UnloadEngine(&first);  // next game belongs to other pairing;
 	UnloadEngine(&second); // already unload the engines, so TwoMachinesEvent will load new ones.
     }
+    if(gameNr >= 0) SaveStandings();
     if(appData.debugMode) fprintf(debugFP, "Reserved, next=%d, nr=%d\n", nextGame, gameNr);
 }
 
@@ -1583,6 +1927,7 @@ MatchEvent (int mode)
 	matchMode = mode;
 	matchGame = roundNr = 1;
 	first.matchWins = second.matchWins = 0; // [HGM] match: needed in later matches
+	MatchStatsReset();
 	NextMatchGame();
 }
 
@@ -1815,6 +2160,7 @@ HistorySet (char movelist[][2*MOVE_LEN], int first, int last, int current)
     EvalGraphSet( first, last, current, pvInfoList );
 
     MakeEngineOutputTitle();
+    gameStorageMoved = FALSE;
 }
 
 /*
@@ -2306,6 +2652,114 @@ StringToVariant (char *e)
 static int leftover_start = 0, leftover_len = 0;
 char star_match[STAR_MATCH_N][MSG_SIZ];
 
+/* The patterns passed to looking_at() are compiled (on first use) into tries
+   of their literal parts: patterns that start with a literal go into the main
+   trie, keyed on the text up to the first '*'; patterns that start with "*c"
+   go into a trie for the delimiter c, keyed on the text from c to the next '*'.
+   On the first looking_at() call at a new position all tries are walked in a
+   single pass over the text, which gives the set of patterns that could match
+   there. Other patterns are then rejected without even looking at the text.
+   Patterns are identified by their address, so they must be constant strings.
+   */
+#define MAX_PATTERNS 512
+#define MAX_PATTERN_NODES 8192
+#define NO_ANCHOR 256 /* root of trie for patterns without leading '*' */
+
+typedef struct {
+    char c;
+    short child, sibling; /* trie links; 0 = none */
+    short patterns;       /* first pattern with its literal part ending here, or -1 */
+} PatternNode;
+
+static PatternNode patternNode[MAX_PATTERN_NODES];
+static int nrOfPatternNodes = 1, nrOfPatterns;
+static char *patternString[MAX_PATTERNS];
+static short patternNext[MAX_PATTERNS], patternRoot[NO_ANCHOR+1], anchorList[NO_ANCHOR], nrOfAnchors;
+static short patternHash[2*MAX_PATTERNS]; /* pattern address -> number+1 */
+static unsigned int candidates[MAX_PATTERNS/32], wildPatterns[MAX_PATTERNS/32];
+static char *scanBuf; /* text and position the candidates were determined for */
+static int scanIndex;
+
+static int
+NewPatternNode (char c)
+{
+    PatternNode *n = patternNode + nrOfPatternNodes;
+    if(nrOfPatternNodes >= MAX_PATTERN_NODES) return 0;
+    n->c = c; n->child = n->sibling = 0; n->patterns = -1;
+    return nrOfPatternNodes++;
+}
+
+static int
+CompilePattern (char *pattern)
+{   // returns number of pattern, or -1 if it could not be accommodated
+    int h = ((size_t) pattern >> 2) % (2*MAX_PATTERNS), node, k;
+    char *p = pattern, *q;
+
+    while(patternHash[h]) {
+	if(patternString[patternHash[h]-1] == pattern) return patternHash[h] - 1;
+	if(++h == 2*MAX_PATTERNS) h = 0;
+    }
+    if(nrOfPatterns >= MAX_PATTERNS) return -1;
+    k = nrOfPatterns++; patternHash[h] = k + 1; patternString[k] = pattern;
+    scanBuf = NULL; // candidate set for current position lacks the new pattern
+    if(*p == '*') { // leading wildcard: anchor on the character that terminates it
+	if(p[1] == '*' || p[1] == NULLCHAR) { wildPatterns[k>>5] |= 1<<(k&31); return k; } // always try
+	p++; h = (unsigned char) *p;
+    } else h = NO_ANCHOR;
+    if(!patternRoot[h]) {
+	if(!(patternRoot[h] = NewPatternNode(NULLCHAR))) { wildPatterns[k>>5] |= 1<<(k&31); return k; }
+	if(h != NO_ANCHOR) anchorList[nrOfAnchors++] = h;
+    }
+    node = patternRoot[h];
+    for(q = p; *q && *q != '*'; q++) { // descend trie, adding nodes where needed
+	int c = patternNode[node].child;
+	while(c && patternNode[c].c != *q) c = patternNode[c].sibling;
+	if(!c) {
+	    if(!(c = NewPatternNode(*q))) { wildPatterns[k>>5] |= 1<<(k&31); return k; }
+	    patternNode[c].sibling = patternNode[node].child; patternNode[node].child = c;
+	}
+	node = c;
+    }
+    patternNext[k] = patternNode[node].patterns; patternNode[node].patterns = k;
+    return k;
+}
+
+static void
+WalkPatternTrie (int node, char *p)
+{   // mark all patterns whose literal part in this trie matches the text at p
+    int k;
+    while(1) {
+	for(k = patternNode[node].patterns; k >= 0; k = patternNext[k]) candidates[k>>5] |= 1<<(k&31);
+	if(*p == NULLCHAR) return;
+	for(node = patternNode[node].child; node && patternNode[node].c != *p; node = patternNode[node].sibling);
+	if(!node) return;
+	p++;
+    }
+}
+
+static void
+ScanPatterns (char *buf, int index)
+{   // determine which of the compiled patterns could match at buf[index]
+    static int firstSeen[256], stamp[256], scanNr;
+    char *p = buf + index;
+    int i;
+
+    scanBuf = buf; scanIndex = index;
+    for(i=0; i<MAX_PATTERNS/32; i++) candidates[i] = wildPatterns[i];
+    if(patternRoot[NO_ANCHOR]) WalkPatternTrie(patternRoot[NO_ANCHOR], p);
+    if(!nrOfAnchors) return;
+    // a leading '*' extends to the first occurrence of its delimiter in the current line
+    scanNr++;
+    for(i=0; p[i] && p[i] != '\n' && p[i] != '\r'; i++) {
+	int c = (unsigned char) p[i];
+	if(stamp[c] != scanNr) stamp[c] = scanNr, firstSeen[c] = i;
+    }
+    for(i=0; i<nrOfAnchors; i++) {
+	int c = anchorList[i];
+	if(stamp[c] == scanNr) WalkPatternTrie(patternRoot[c], p + firstSeen[c]);
+    }
+}
+
 /* Test whether pattern is present at &buf[*index]; if so, return TRUE,
    advance *index beyond it, and set leftover_start to the new value of
    *index; else return FALSE.  If pattern contains the character '*', it
@@ -2317,9 +2771,14 @@ int
 looking_at ( char *buf, int *index, char *pattern)
 {
     char *bufp = &buf[*index], *patternp = pattern;
-    int star_count = 0;
+    int star_count = 0, k = CompilePattern(pattern);
     char *matchp = star_match[0];
 
+    if(k >= 0) { // quick rejection through the compiled tries
+	if(buf != scanBuf || *index != scanIndex) ScanPatterns(buf, *index);
+	if(!(candidates[k>>5] & 1<<(k&31))) return FALSE;
+    }
+
     for (;;) {
 	if (*patternp == NULLCHAR) {
 	    *index = leftover_start = bufp - buf;
@@ -2601,22 +3060,119 @@ int suppressKibitz = 0;
 // [HGM] seekgraph
 Boolean soughtPending = FALSE;
 Boolean seekGraphUp;
-#define MAX_SEEK_ADS 200
 #define SQUARE 0x80
-char *seekAdList[MAX_SEEK_ADS];
-int ratingList[MAX_SEEK_ADS], xList[MAX_SEEK_ADS], yList[MAX_SEEK_ADS], seekNrList[MAX_SEEK_ADS], zList[MAX_SEEK_ADS];
-float tcList[MAX_SEEK_ADS];
-char colorList[MAX_SEEK_ADS];
+/* Seek ads are kept in an array that grows as needed. A hash table on the ad number finds the ad
+ * to remove, and a uniform grid over the plotted dot positions (cells at least as large as a dot
+ * and the click radius) finds the dots near a click or an erased dot. Both are chains of array
+ * indices; a removed ad is replaced by the last one, which is then relinked under its new index.
+ */
+typedef struct {
+    char *text;
+    int nr, rating, x, y, z, age;
+    float tc;
+    char color;           // classified when the ad is added
+    int cell, nextNr, nextInCell;
+} SeekAd;
+
+static SeekAd *seekAds;
+static int maxSeekAds, hashMask = -1, *seekHash;
+static int *seekGrid, gridW, gridH, gridSize, presses;
 int nrOfSeekAds = 0;
 int minRating = 1010, maxRating = 2800;
 int hMargin = 10, vMargin = 20, h, w;
 extern int squareSize, lineGap;
 
+static void
+HashAd (int i)
+{
+    int *p = &seekHash[seekAds[i].nr & hashMask];
+    seekAds[i].nextNr = *p; *p = i;
+}
+
+static void
+UnhashAd (int i)
+{
+    int *p = &seekHash[seekAds[i].nr & hashMask];
+    while(*p != i) p = &seekAds[*p].nextNr;
+    *p = seekAds[i].nextNr;
+}
+
+static void
+GridAd (int i)
+{   // put a plotted dot in the grid cell it falls in
+    SeekAd *a = &seekAds[i];
+    int gx = a->x / gridSize, gy = a->y / gridSize;
+    a->cell = -1;
+    if(!seekGrid || a->x < 0 || a->y < 0 || gx >= gridW || gy >= gridH) return;
+    a->cell = gy*gridW + gx;
+    a->nextInCell = seekGrid[a->cell]; seekGrid[a->cell] = i;
+}
+
+static void
+UngridAd (int i)
+{
+    int *p;
+    if(seekAds[i].cell < 0) return;
+    p = &seekGrid[seekAds[i].cell];
+    while(*p != i) p = &seekAds[*p].nextInCell;
+    *p = seekAds[i].nextInCell;
+}
+
+static int
+NearCells (int x, int y, int *cells)
+{   // the grid cells around a point, which together contain all dots closer than gridSize
+    int gx, gy, dx, dy, n = 0;
+    if(!seekGrid || x < 0 || y < 0) return 0;
+    gx = x / gridSize; gy = y / gridSize;
+    for(dy=-1; dy<=1; dy++) for(dx=-1; dx<=1; dx++)
+	if(gx+dx >= 0 && gx+dx < gridW && gy+dy >= 0 && gy+dy < gridH) cells[n++] = (gy+dy)*gridW + gx + dx;
+    return n;
+}
+
+static void
+MakeSeekGrid ()
+{   // (re)create an empty grid for the current graph size; all dots have to be plotted again
+    int i;
+    gridSize = (squareSize/4 > 11 ? squareSize/4 : 11);
+    gridW = w/gridSize + 1; gridH = h/gridSize + 1;
+    seekGrid = (int *) realloc(seekGrid, gridW*gridH*sizeof(int));
+    for(i=0; i<gridW*gridH; i++) seekGrid[i] = -1;
+    for(i=0; i<nrOfSeekAds; i++) seekAds[i].cell = -1;
+}
+
+static int
+FindSeekAd (int nr)
+{
+    int i;
+    if(hashMask < 0) return -1;
+    for(i = seekHash[nr & hashMask]; i >= 0; i = seekAds[i].nextNr) if(seekAds[i].nr == nr) return i;
+    return -1;
+}
+
+static int
+SeekZ (int i)
+{   // the priority penalty of an ad, which decays by 20% for every press in the graph
+    SeekAd *a = &seekAds[i];
+    while(a->age < presses && a->z > 0) a->z *= 0.8, a->age++;
+    a->age = presses;
+    return a->z;
+}
+
+static void
+ClearSeekAds ()
+{
+    int i;
+    for(i=0; i<nrOfSeekAds; i++) free(seekAds[i].text);
+    for(i=0; i<=hashMask; i++) seekHash[i] = -1;
+    if(seekGrid) for(i=0; i<gridW*gridH; i++) seekGrid[i] = -1;
+    nrOfSeekAds = 0;
+}
+
 void
 PlotSeekAd (int i)
 {
-	int x, y, color = 0, r = ratingList[i]; float tc = tcList[i];
-	xList[i] = yList[i] = -100; // outside graph, so cannot be clicked
+	SeekAd *a = &seekAds[i];
+	int x, y, r = a->rating; float tc = a->tc;
 	if(r < minRating+100 && r >=0 ) r = minRating+100;
 	if(r > maxRating) r = maxRating;
 	if(tc < 1.f) tc = 1.f;
@@ -2624,14 +3180,10 @@ PlotSeekAd (int i)
 	x = (w-hMargin-squareSize/8-7)* log(tc)/log(95.) + hMargin;
 	y = ((double)r - minRating)/(maxRating - minRating)
 	    * (h-vMargin-squareSize/8-1) + vMargin;
-	if(ratingList[i] < 0) y = vMargin + squareSize/4;
-	if(strstr(seekAdList[i], " u ")) color = 1;
-	if(!strstr(seekAdList[i], "lightning") && // for now all wilds same color
-	   !strstr(seekAdList[i], "bullet") &&
-	   !strstr(seekAdList[i], "blitz") &&
-	   !strstr(seekAdList[i], "standard") ) color = 2;
-	if(strstr(seekAdList[i], "(C) ")) color |= SQUARE; // plot computer seeks as squares
-	DrawSeekDot(xList[i]=x+3*(color&~SQUARE), yList[i]=h-1-y, colorList[i]=color);
+	if(a->rating < 0) y = vMargin + squareSize/4;
+	UngridAd(i);
+	DrawSeekDot(a->x=x+3*(a->color&~SQUARE), a->y=h-1-y, a->color);
+	GridAd(i);
 }
 
 void
@@ -2645,6 +3197,8 @@ AddAd (char *handle, char *rating, int base, int inc,  char rated, char *type, i
 {
 	char buf[MSG_SIZ], *ext = "";
 	VariantClass v = StringToVariant(type);
+	SeekAd *a;
+	int i;
 	if(strstr(type, "wild")) {
 	    ext = type + 4; // append wild number
 	    if(v == VariantFischeRandom) type = "chess960"; else
@@ -2652,50 +3206,63 @@ AddAd (char *handle, char *rating, int base, int inc,  char rated, char *type, i
 	    type = VariantName(v);
 	}
 	snprintf(buf, MSG_SIZ, "%s (%s) %d %d %c %s%s", handle, rating, base, inc, rated, type, ext);
-	if(nrOfSeekAds < MAX_SEEK_ADS-1) {
-	    if(seekAdList[nrOfSeekAds]) free(seekAdList[nrOfSeekAds]);
-	    ratingList[nrOfSeekAds] = -1; // for if seeker has no rating
-	    sscanf(rating, "%d", &ratingList[nrOfSeekAds]);
-	    tcList[nrOfSeekAds] = base + (2./3.)*inc;
-	    seekNrList[nrOfSeekAds] = nr;
-	    zList[nrOfSeekAds] = 0;
-	    seekAdList[nrOfSeekAds++] = StrSave(buf);
-	    if(plot) PlotSingleSeekAd(nrOfSeekAds-1);
-	}
+	if(nrOfSeekAds >= maxSeekAds) { // grow table, and rehash
+	    maxSeekAds = (maxSeekAds ? 2*maxSeekAds : 256);
+	    seekAds = (SeekAd *) realloc(seekAds, maxSeekAds*sizeof(SeekAd));
+	    hashMask = 2*maxSeekAds - 1;
+	    seekHash = (int *) realloc(seekHash, (hashMask+1)*sizeof(int));
+	    for(i=0; i<=hashMask; i++) seekHash[i] = -1;
+	    for(i=0; i<nrOfSeekAds; i++) HashAd(i);
+	}
+	a = &seekAds[i = nrOfSeekAds++];
+	a->rating = -1; // for if seeker has no rating
+	sscanf(rating, "%d", &a->rating);
+	a->tc = base + (2./3.)*inc;
+	a->nr = nr;
+	a->z = 0; a->age = presses;
+	a->x = a->y = -100; // outside graph, so cannot be clicked
+	a->cell = -1;
+	a->text = StrSave(buf);
+	a->color = 0;
+	if(strstr(buf, " u ")) a->color = 1;
+	if(!strstr(buf, "lightning") && // for now all wilds same color
+	   !strstr(buf, "bullet") &&
+	   !strstr(buf, "blitz") &&
+	   !strstr(buf, "standard") ) a->color = 2;
+	if(strstr(buf, "(C) ")) a->color |= SQUARE; // plot computer seeks as squares
+	HashAd(i);
+	if(plot) PlotSingleSeekAd(i);
 }
 
 void
 EraseSeekDot (int i)
 {
-    int x = xList[i], y = yList[i], d=squareSize/4, k;
+    int x = seekAds[i].x, y = seekAds[i].y, d=squareSize/4, k, c, n, cells[9];
     DrawSeekBackground(x-squareSize/8, y-squareSize/8, x+squareSize/8+1, y+squareSize/8+1);
     if(x < hMargin+d) DrawSeekAxis(hMargin, y-squareSize/8, hMargin, y+squareSize/8+1);
     // now replot every dot that overlapped
-    for(k=0; k<nrOfSeekAds; k++) if(k != i) {
-	int xx = xList[k], yy = yList[k];
+    n = NearCells(x, y, cells);
+    for(c=0; c<n; c++) for(k=seekGrid[cells[c]]; k>=0; k=seekAds[k].nextInCell) if(k != i) {
+	int xx = seekAds[k].x, yy = seekAds[k].y;
 	if(xx <= x+d && xx > x-d && yy <= y+d && yy > y-d)
-	    DrawSeekDot(xx, yy, colorList[k]);
+	    DrawSeekDot(xx, yy, seekAds[k].color);
     }
 }
 
 void
 RemoveSeekAd (int nr)
 {
-	int i;
-	for(i=0; i<nrOfSeekAds; i++) if(seekNrList[i] == nr) {
-	    EraseSeekDot(i);
-	    if(seekAdList[i]) free(seekAdList[i]);
-	    seekAdList[i] = seekAdList[--nrOfSeekAds];
-	    seekNrList[i] = seekNrList[nrOfSeekAds];
-	    ratingList[i] = ratingList[nrOfSeekAds];
-	    colorList[i]  = colorList[nrOfSeekAds];
-	    tcList[i] = tcList[nrOfSeekAds];
-	    xList[i]  = xList[nrOfSeekAds];
-	    yList[i]  = yList[nrOfSeekAds];
-	    zList[i]  = zList[nrOfSeekAds];
-	    seekAdList[nrOfSeekAds] = NULL;
-	    break;
+	int i = FindSeekAd(nr), last = nrOfSeekAds - 1;
+	if(i < 0) return;
+	EraseSeekDot(i);
+	UnhashAd(i); UngridAd(i);
+	free(seekAds[i].text);
+	if(i != last) { // move last ad into the hole
+	    UnhashAd(last); UngridAd(last);
+	    seekAds[i] = seekAds[last];
+	    HashAd(i); if(seekAds[i].cell >= 0) GridAd(i);
 	}
+	nrOfSeekAds--;
 }
 
 Boolean
@@ -2723,6 +3290,7 @@ DrawSeekGraph ()
     if(!seekGraphUp) return FALSE;
     h = BOARD_HEIGHT * (squareSize + lineGap) + lineGap + 2*border;
     w = BOARD_WIDTH  * (squareSize + lineGap) + lineGap + 2*border;
+    MakeSeekGrid();
 
     DrawSeekBackground(0, 0, w, h);
     DrawSeekAxis(hMargin, h-1-vMargin, w-5, h-1-vMargin);
@@ -2765,39 +3333,41 @@ SeekGraphClick (ClickType click, int x, int y, int moving)
     }
     if(!seekGraphUp) { // initiate cration of seek graph by requesting seek-ad list
 	if(click == Release || moving) return FALSE;
-	nrOfSeekAds = 0;
+	ClearSeekAds();
 	soughtPending = TRUE;
 	SendToICS(ics_prefix);
 	SendToICS("sought\n"); // should this be "sought all"?
     } else { // issue challenge based on clicked ad
-	int dist = 10000; int i, closest = 0, second = 0;
-	for(i=0; i<nrOfSeekAds; i++) {
-	    int d = (x-xList[i])*(x-xList[i]) +  (y-yList[i])*(y-yList[i]) + zList[i];
+	int dist = 10000; int i, c, n, closest = 0, second = 0, cells[9];
+	n = NearCells(x, y, cells); // only dots in these cells can be within click range
+	for(c=0; c<n; c++) for(i=seekGrid[cells[c]]; i>=0; i=seekAds[i].nextInCell) {
+	    int z = SeekZ(i), d = (x-seekAds[i].x)*(x-seekAds[i].x) +  (y-seekAds[i].y)*(y-seekAds[i].y) + z;
 	    if(d < dist) { dist = d; closest = i; }
-	    second += (d - zList[i] < 120); // count in-range ads
-	    if(click == Press && moving != 1 && zList[i]>0) zList[i] *= 0.8; // age priority
+	    second += (d - z < 120); // count in-range ads
 	}
+	if(click == Press && moving != 1) presses++; // age priority of all ads
 	if(dist < 120) {
 	    char buf[MSG_SIZ];
 	    second = (second > 1);
 	    if(displayed != closest || second != lastSecond) {
-		DisplayMessage(second ? "!" : "", seekAdList[closest]);
+		DisplayMessage(second ? "!" : "", seekAds[closest].text);
 		lastSecond = second; displayed = closest;
 	    }
 	    if(click == Press) {
-		if(moving == 2) zList[closest] = 100; // right-click; push to back on press
-		lastDown = closest;
+		if(moving == 2) seekAds[closest].z = 100, seekAds[closest].age = presses; // right-click; push to back on press
+		lastDown = seekAds[closest].nr;
 		return TRUE;
 	    } // on press 'hit', only show info
 	    if(moving == 2) return TRUE; // ignore right up-clicks on dot
-	    snprintf(buf, MSG_SIZ, "play %d\n", seekNrList[closest]);
+	    snprintf(buf, MSG_SIZ, "play %d\n", seekAds[closest].nr);
 	    SendToICS(ics_prefix);
 	    SendToICS(buf);
 	    return TRUE; // let incoming board of started game pop down the graph
 	} else if(click == Release) { // release 'miss' is ignored
-	    zList[lastDown] = 100; // make future selection of the rejected ad more difficult
+	    if((i = FindSeekAd(lastDown)) >= 0) // make future selection of the rejected ad more difficult
+		seekAds[i].z = 100, seekAds[i].age = presses;
 	    if(moving == 2) { // right up-click
-		nrOfSeekAds = 0; // refresh graph
+		ClearSeekAds(); // refresh graph
 		soughtPending = TRUE;
 		SendToICS(ics_prefix);
 		SendToICS("sought\n"); // should this be "sought all"?
@@ -2928,6 +3498,7 @@ read_from_ics (InputSourceRef isr, VOIDSTAR closure, char *data, int count, int
     }
 
 	buf[buf_len] = NULLCHAR;
+	scanBuf = NULL; // new text, so pattern candidates must be determined afresh
 //	next_out = leftover_len; // [HGM] should we set this to 0, and not print it in advance?
 	next_out = 0;
 	leftover_start = 0;
@@ -3751,6 +4322,7 @@ read_from_ics (InputSourceRef isr, VOIDSTAR closure, char *data, int count, int
 		    memcpy(&parse[parse_pos], &buf[oldi], i - oldi);
 		    parse[parse_pos + i - oldi] = NULLCHAR;
 		    ParseGameHistory(parse);
+		    if (nrOfObserved && gameMode == IcsObserving) ObservedGameHistory(ics_gamenum);
 #if ZIPPY
 		    if (appData.zippyPlay && first.initDone) {
 		        FeedMovesToProgram(&first, forwardMostMove);
@@ -4053,6 +4625,7 @@ read_from_ics (InputSourceRef isr, VOIDSTAR closure, char *data, int count, int
 		}
 
 		/* Game end messages */
+		if (nrOfObserved) ObservedGameEnds(gamenum, why, endtoken);
 		if (gameMode == IcsIdle || gameMode == BeginningOfGame ||
 		    ics_gamenum != gamenum) {
 		    continue;
@@ -4096,6 +4669,7 @@ read_from_ics (InputSourceRef isr, VOIDSTAR closure, char *data, int count, int
 	    if (looking_at(buf, &i, "Removing game * from observation") ||
 		looking_at(buf, &i, "no longer observing game *") ||
 		looking_at(buf, &i, "Game * (*) has no examiners")) {
+		if (nrOfObserved) ForgetObservedGame(atoi(star_match[0]));
 		if (gameMode == IcsObserving &&
 		    atoi(star_match[0]) == ics_gamenum)
 		  {
@@ -4308,6 +4882,184 @@ read_from_ics (InputSourceRef isr, VOIDSTAR closure, char *data, int count, int
 #define RELATION_ISOLATED_BOARD     -3
 #define RELATION_STARTING_POSITION  -4   /* FICS only */
 
+/* Table of all games we observe on the ICS, so that each of them can be saved
+   when it ends, while only the one selected for display (ics_gamenum) uses the
+   normal game storage. Only used when an observeSaveFile is given.
+   The moves are kept as the SAN strings that come with the style-12 boards,
+   from a starting position in FEN, which is that of the first board we saw
+   unless the move list of the game has been fetched for display. */
+
+typedef struct {
+    int gamenum;          /* ICS game number, -1 for a free entry */
+    char white[32], black[32];
+    int basetime, increment;
+    char *date;
+    char fen[MSG_SIZ];    /* position before the first recorded move */
+    int first;            /* number of that position */
+    int nrOfMoves;
+    int *start;           /* offset of SAN of each recorded move in text */
+    char *text;
+    int len, size;
+} ObservedGame;
+
+static ObservedGame *observed;
+
+static ObservedGame *
+FindObservedGame (int gamenum, int create)
+{
+    int i, free = -1;
+    for(i=0; i<nrOfObserved; i++) {
+	if(observed[i].gamenum == gamenum) return observed + i;
+	if(observed[i].gamenum < 0) free = i;
+    }
+    if(!create) return NULL;
+    if(free < 0) {
+	ObservedGame *new = (ObservedGame *) realloc(observed, (nrOfObserved + 1) * sizeof(ObservedGame));
+	if(!new) return NULL;
+	observed = new; free = nrOfObserved++;
+	memset(observed + free, 0, sizeof(ObservedGame));
+    }
+    observed[free].gamenum = gamenum; observed[free].nrOfMoves = observed[free].len = 0;
+    observed[free].fen[0] = NULLCHAR;
+    return observed + free;
+}
+
+static void
+ForgetObservedGame (int gamenum)
+{
+    ObservedGame *g = FindObservedGame(gamenum, FALSE);
+    if(!g) return;
+    g->gamenum = -1;
+    FREE(g->date); g->date = NULL;
+}
+
+static int
+AddObservedMove (ObservedGame *g, char *san)
+{
+    int n = strlen(san) + 1;
+    if(g->len + n > g->size) { // grow buffers in chunks
+	char *text = (char *) realloc(g->text, g->size + 4096);
+	if(!text) return FALSE;
+	g->text = text; g->size += 4096;
+    }
+    if(!(g->nrOfMoves & 255)) {
+	int *start = (int *) realloc(g->start, (g->nrOfMoves + 256) * sizeof(int));
+	if(!start) return FALSE;
+	g->start = start;
+    }
+    g->start[g->nrOfMoves++] = g->len;
+    strcpy(g->text + g->len, san);
+    g->len += n;
+    return TRUE;
+}
+
+static void
+Style12ToFEN (char *fen, char *board, char toPlay, int ranks, int doublePush, int castle[4], int irrev, int moveNum)
+{   // convert the board and flags of a style-12 line to FEN
+    int empty = 0;
+    for(; *board; board++) {
+	if(*board == '-') { empty++; continue; }
+	if(empty) fen += sprintf(fen, "%d", empty), empty = 0;
+	*fen++ = (*board == ' ' ? '/' : *board);
+    }
+    if(empty) fen += sprintf(fen, "%d", empty);
+    fen += sprintf(fen, " %c ", toPlay == 'W' ? 'w' : 'b');
+    if(castle[0]) *fen++ = 'K';
+    if(castle[1]) *fen++ = 'Q';
+    if(castle[2]) *fen++ = 'k';
+    if(castle[3]) *fen++ = 'q';
+    if(!(castle[0] | castle[1] | castle[2] | castle[3])) *fen++ = '-';
+    if(doublePush >= 0) sprintf(fen, " %c%d %d %d", 'a' + doublePush, toPlay == 'W' ? ranks - 2 : 3, irrev, moveNum/2 + 1);
+    else sprintf(fen, " - %d %d", irrev, moveNum/2 + 1);
+}
+
+static int
+RecordObservedBoard (int gamenum, char *white, char *black, int basetime, int increment, int moveNum, char *san, char *fen)
+{   // update the entry of an observed game with a newly arrived board; returns FALSE if it brings nothing new
+    ObservedGame *g = FindObservedGame(gamenum, FALSE);
+    int n;
+
+    if(!g) {
+	if(!(g = FindObservedGame(gamenum, TRUE))) return TRUE;
+	safeStrCpy(g->white, white, sizeof(g->white));
+	safeStrCpy(g->black, black, sizeof(g->black));
+	g->basetime = basetime; g->increment = increment;
+	g->date = PGNDate();
+    } else if(g->fen[0]) {
+	n = moveNum - g->first;
+	if(n == g->nrOfMoves) return FALSE; // nothing new: refresh
+	if(n > 0 && n <= g->nrOfMoves + 1 && strcmp(san, "none")) { // next move, or take-back
+	    if(n <= g->nrOfMoves) g->nrOfMoves = n - 1, g->len = g->start[n-1]; // take-back
+	    AddObservedMove(g, san);
+	    return TRUE;
+	}
+    }
+    // first board or gap in the moves: (re)start recording from this position
+    safeStrCpy(g->fen, fen, MSG_SIZ);
+    g->first = moveNum; g->nrOfMoves = g->len = 0;
+    return TRUE;
+}
+
+static void
+ObservedGameHistory (int gamenum)
+{   // move list of the displayed game was fetched: record it from the start
+    ObservedGame *g = FindObservedGame(gamenum, FALSE);
+    int i;
+    char san[MOVE_LEN], *p, *fen;
+
+    if(!g) return;
+    fen = PositionToFEN(backwardMostMove, NULL, 1);
+    safeStrCpy(g->fen, fen, MSG_SIZ); free(fen);
+    g->first = backwardMostMove; g->nrOfMoves = g->len = 0;
+    for(i=backwardMostMove; i<forwardMostMove; i++) {
+	safeStrCpy(san, parseList[i], MOVE_LEN);
+	if(p = strchr(san, ' ')) *p = NULLCHAR; // strip elapsed time
+	if(!AddObservedMove(g, san)) break;
+    }
+}
+
+static void
+ObservedGameEnds (int gamenum, char *why, char *result)
+{   // write a finished observed game to the observeSaveFile as PGN, in one go
+    ObservedGame *g = FindObservedGame(gamenum, FALSE);
+    char *pgn, *p, *q;
+    int i, col, size;
+    FILE *f;
+
+    if(!g) return;
+    while(*result == ' ') result++;
+    if(*result != '1' && *result != '0' && *result != '*') result = "*";
+    size = g->len + 5*g->nrOfMoves + strlen(g->fen) + strlen(why) + 1000
+	 + strlen(appData.icsHost) + strlen(g->date) + strlen(g->white) + strlen(g->black);
+    if(g->nrOfMoves && (pgn = malloc(size))) {
+	p = pgn;
+	snprintf(p, size, "[Event \"ICS game %d\"]\n[Site \"%s\"]\n[Date \"%s\"]\n[Round \"-\"]\n"
+		      "[White \"%s\"]\n[Black \"%s\"]\n[Result \"%s\"]\n",
+		      gamenum, appData.icsHost, g->date, g->white, g->black, result);
+	p += strlen(p);
+	if(strcmp(g->fen, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"))
+	    p += sprintf(p, "[SetUp \"1\"]\n[FEN \"%s\"]\n", g->fen);
+	p += sprintf(p, "[TimeControl \"%d+%d\"]\n\n", g->basetime*60, g->increment);
+	for(i=col=0; i<g->nrOfMoves; i++) {
+	    char num[20], *san = g->text + g->start[i];
+	    int m = g->first + i, n = 0;
+	    if(!(m & 1)) n = sprintf(num, "%d. ", m/2 + 1); else
+	    if(i == 0) n = sprintf(num, "%d... ", m/2 + 1);
+	    if(col + n + strlen(san) > 75) *p++ = '\n', col = 0;
+	    else if(col) *p++ = ' ', col++;
+	    if(n) strcpy(p, num), p += n, col += n;
+	    q = san; while(*q) *p++ = *q++, col++;
+	}
+	p += sprintf(p, "\n{%s} %s\n\n", why, result);
+	if((f = fopen(appData.observeSaveFile, "a"))) {
+	    fwrite(pgn, 1, p - pgn, f);
+	    fclose(f);
+	}
+	free(pgn);
+    }
+    ForgetObservedGame(gamenum);
+}
+
 void
 ParseBoard12 (char *string)
 {
@@ -4368,8 +5120,8 @@ ParseBoard12 (char *string)
     /* Convert the move number to internal form */
     moveNum = (moveNum - 1) * 2;
     if (to_play == 'B') moveNum++;
-    if (moveNum > framePtr) { // [HGM] vari: do not run into saved variations
-      DisplayFatalError(_("Game too long; increase MAX_MOVES and recompile"),
+    if (moveNum > framePtr && !GrowGameStorage(moveNum)) { // [HGM] vari: do not run into saved variations
+      DisplayFatalError(_("Game too long; out of memory"),
 			0, 1);
       return;
     }
@@ -4404,6 +5156,17 @@ ParseBoard12 (char *string)
 	break;
     }
 
+    if(appData.observeSaveFile && *appData.observeSaveFile && relation == RELATION_OBSERVING_PLAYED && gamenum >= 0 &&
+       (ics_getting_history == H_FALSE || ics_getting_history == H_REQUESTED)) {
+	char fen[MSG_SIZ];
+	int castle[4];
+	castle[0] = castle_ws; castle[1] = castle_wl; castle[2] = castle_bs; castle[3] = castle_bl;
+	Style12ToFEN(fen, board_chars, to_play, ranks, double_push, castle, irrev_count, moveNum);
+	// a game other than the displayed one is only recorded, unless a refresh asks to display it
+	if(RecordObservedBoard(gamenum, white, black, basetime, increment, moveNum, move_str, fen)
+	   && gameMode == IcsObserving && gamenum != ics_gamenum && ics_gamenum >= 0 && !(appData.dualBoard && appData.bgObserve)) return;
+    }
+
     if((gameMode == IcsPlayingWhite || gameMode == IcsPlayingBlack ||
 	gameMode == IcsObserving && appData.dualBoard) // also allow use of second board for observing two games
 	 && newGameMode == IcsObserving && gamenum != ics_gamenum && appData.bgObserve) {
@@ -5603,7 +6366,7 @@ ParsePV (char *pv, Boolean storeComments, Boolean atEnd)
 
   lastParseAttempt = pv; if(!*pv) return;    // turns out we crash when we parse an empty PV
   if ((gameMode == AnalyzeMode || gameMode == AnalyzeFile) && currentMove < forwardMostMove) {
-    PushInner(currentMove, forwardMostMove); // [HGM] engine might not be thinking on forwardMost position!
+    if(!PushInner(currentMove, forwardMostMove)) { endPV = forwardMostMove; return; } // [HGM] engine might not be thinking on forwardMost position!
     pushed = TRUE;
   }
   endPV = forwardMostMove;
@@ -5637,7 +6400,7 @@ ParsePV (char *pv, Boolean storeComments, Boolean atEnd)
 	continue;
     }
     nr++;
-    if(endPV+1 > framePtr) break; // no space, truncate
+    if(endPV+1 > framePtr && !GrowGameStorage(endPV+1)) break; // no space, truncate
     if(!valid) break;
     endPV++;
     CopyBoard(boards[endPV], boards[endPV-1]);
@@ -5654,6 +6417,7 @@ ParsePV (char *pv, Boolean storeComments, Boolean atEnd)
   if(currentMove == forwardMostMove) ClearPremoveHighlights(); else
   SetPremoveHighlights(moveList[currentMove-1][0]-AAA, moveList[currentMove-1][1]-ONE,
                        moveList[currentMove-1][2]-AAA, moveList[currentMove-1][3]-ONE);
+  if(gameStorageMoved) HistorySet(parseList, backwardMostMove, forwardMostMove, currentMove-1);
   DrawPosition(TRUE, boards[currentMove]);
 }
 
@@ -5713,7 +6477,7 @@ PvToSAN (char *pv)
 	static char buf[10*MSG_SIZ];
 	int i, k=0, savedEnd=endPV, saveFMM = forwardMostMove;
 	*buf = NULLCHAR;
-	if(forwardMostMove < endPV) PushInner(forwardMostMove, endPV); // shelve PV of PV-walk
+	if(forwardMostMove < endPV && !PushInner(forwardMostMove, endPV)) return pv; // shelve PV of PV-walk
 	ParsePV(pv, FALSE, 2); // this appends PV to game, suppressing any display of it
 	for(i = forwardMostMove; i<endPV; i++){
 	    if(i&1) snprintf(buf+k, 10*MSG_SIZ-k, "%s ", parseList[i]);
@@ -6378,7 +7142,7 @@ SendBoard (ChessProgramState *cps, int moveNum)
       free(fen);
 
     } else {
-      ChessSquare *bp;
+      BoardCell *bp;
       int i, j, left=0, right=BOARD_WIDTH;
       /* Kludge to set black to move, avoiding the troublesome and now
        * deprecated "black" command.
@@ -7136,8 +7900,8 @@ FinishMove (ChessMove moveType, int fromX, int fromY, int toX, int toY, int prom
      the previous line in Analysis Mode */
   if ((gameMode == AnalyzeMode || gameMode == EditGame || gameMode == PlayFromGameFile && appData.variations && shiftKey)
 				&& currentMove < forwardMostMove) {
-    if(appData.variations && shiftKey) PushTail(currentMove, forwardMostMove); // [HGM] vari: save tail of game
-    else forwardMostMove = currentMove;
+    if(!(appData.variations && shiftKey && PushTail(currentMove, forwardMostMove))) // [HGM] vari: save tail of game
+	forwardMostMove = currentMove; // or discard it
   }
 
   ClearMap();
@@ -7218,6 +7982,7 @@ FinishMove (ChessMove moveType, int fromX, int fromY, int toX, int toY, int prom
   }
 
   ShowMove(fromX, fromY, toX, toY); /*updates currentMove*/
+  if (gameMode == AnalyzeMode) ShowCachedAnalysis();
 
   switch (gameMode) {
   case EditGame:
@@ -7927,46 +8692,152 @@ ClearEngineOutputPane (int which)
 
 #define MAXPLAYERS 500
 
+/* Tourney standings, updated incrementally: only games of which the result changed since
+   the previous update have to be paired up again, to correct the scores of their players */
+static struct {
+    int nPlayers, nGames;
+    char *participants; /* participants for which the tables are valid */
+    char *counted;      /* result of every game as currently included in the tables */
+    int score[MAXPLAYERS], games[MAXPLAYERS], wins[MAXPLAYERS], draws[MAXPLAYERS], whites[MAXPLAYERS]; // score in half-points
+    int *pairScore, *pairGames; /* nPlayers x nPlayers tables, for player (row) against opponent (column) */
+} standings;
+
+static void
+CountResult (int w, int b, char result, int sign)
+{   // add (sign=1) or subtract (sign=-1) a game result to the standings
+    int n = standings.nPlayers, wScore = 0, bScore = 0;
+    switch(result) {
+      case '+': wScore = 2; standings.wins[w] += sign; break;
+      case '-': bScore = 2; standings.wins[b] += sign; break;
+      case '=': wScore = bScore = 1; standings.draws[w] += sign; standings.draws[b] += sign; break;
+      default: return; // not finished
+    }
+    standings.score[w] += sign*wScore; standings.games[w] += sign; standings.whites[w] += sign;
+    standings.score[b] += sign*bScore; standings.games[b] += sign;
+    standings.pairScore[w*n + b] += sign*wScore; standings.pairGames[w*n + b] += sign;
+    standings.pairScore[b*n + w] += sign*bScore; standings.pairGames[b*n + w] += sign;
+}
+
+static void
+CsvField (FILE *f, char *s)
+{   // quote a text field, doubling the quotes in it, as RFC 4180 wants
+    fputc('"', f);
+    for(; *s; s++) { if(*s == '"') fputc('"', f); fputc(*s, f); }
+    fputc('"', f);
+}
+
+static void
+WriteStandings (char **names)
+{   // save the standings as CSV, to <tourneyFile>.csv (atomically replaced, because several instances might write it)
+    int i, j, k, n = standings.nPlayers, ranking[MAXPLAYERS], sb[MAXPLAYERS];
+    char buf[MSG_SIZ], tmp[MSG_SIZ];
+    FILE *f;
+    for(i=0; i<n; i++) { // Sonneborn-Berger, in quarter points
+	sb[i] = 0;
+	for(j=0; j<n; j++) sb[i] += standings.pairScore[i*n + j] * standings.score[j];
+    }
+    for(i=0; i<n; i++) { // sort on score, then S-B
+	for(j=i; j>0; j--) {
+	    k = ranking[j-1];
+	    if(standings.score[k] > standings.score[i] || standings.score[k] == standings.score[i] && sb[k] >= sb[i]) break;
+	    ranking[j] = k;
+	}
+	ranking[j] = i;
+    }
+    snprintf(buf, MSG_SIZ, "%s.csv", appData.tourneyFile);
+#ifdef WIN32
+    safeStrCpy(tmp, buf, MSG_SIZ); // rename() would not replace existing file
+#else
+    snprintf(tmp, MSG_SIZ, "%s.csv.%d", appData.tourneyFile, (int) getpid());
+#endif
+    if((f = fopen(tmp, "w")) == NULL) return;
+    fprintf(f, "rank,name,points,games,wins,draws,losses,white,black,sonneborn-berger");
+    for(i=0; i<n; i++) fprintf(f, ",%d", i+1); // cross table: points against each opponent
+    fprintf(f, "\n");
+    for(i=0; i<n; i++) {
+	k = ranking[i];
+	fprintf(f, "%d,", i+1); CsvField(f, names[k]);
+	fprintf(f, ",%g,%d,%d,%d,%d,%d,%d,%g", standings.score[k]/2., standings.games[k],
+		standings.wins[k], standings.draws[k], standings.games[k] - standings.wins[k] - standings.draws[k],
+		standings.whites[k], standings.games[k] - standings.whites[k], sb[k]/4.);
+	for(j=0; j<n; j++)
+	    if(j == k || !standings.pairGames[k*n + j]) fprintf(f, ","); else fprintf(f, ",%g", standings.pairScore[k*n + j]/2.);
+	fprintf(f, "\n");
+    }
+    fclose(f);
+    if(strcmp(tmp, buf)) rename(tmp, buf);
+}
+
+static int
+UpdateStandings (char **names)
+{   // bring standings in line with -results; returns number of participants, or 0 if no standings can be made
+    int nr, w, b, color, dummy, n = 0, len = strlen(appData.results);
+    int saveGame = matchGame, saveRound = roundNr, saveGames = appData.matchGames;
+    char *p;
+
+    if(appData.tourneyType < 0) return 0; // Swiss: the pairings are only known to the pairing engine, so no standings
+    names[0] = p = strdup(appData.participants);
+    while(p = strchr(p, '\n')) *p++ = NULLCHAR, names[++n] = p; // count participants
+    if(n < 2 || n > MAXPLAYERS) { free(names[0]); return 0; }
+    if(!standings.participants || strcmp(standings.participants, appData.participants)) { // (new) tourney: start from scratch
+	FREE(standings.pairScore); FREE(standings.pairGames); FREE(standings.counted);
+	ASSIGN(standings.participants, appData.participants);
+	memset(standings.score, 0, sizeof(standings.score)); memset(standings.games, 0, sizeof(standings.games));
+	memset(standings.wins, 0, sizeof(standings.wins));   memset(standings.draws, 0, sizeof(standings.draws));
+	memset(standings.whites, 0, sizeof(standings.whites));
+	standings.pairScore = (int *) calloc(n*n, sizeof(int));
+	standings.pairGames = (int *) calloc(n*n, sizeof(int));
+	standings.nPlayers = n; standings.nGames = 0; standings.counted = NULL;
+    }
+    if(len > standings.nGames) { // tourney got longer; extend record of what we counted
+	standings.counted = realloc(standings.counted, len);
+	memset(standings.counted + standings.nGames, ' ', len - standings.nGames);
+	standings.nGames = len;
+    }
+    for(nr=0; nr<standings.nGames; nr++) {
+	char result = (nr < len ? appData.results[nr] : ' ');
+	if(result == standings.counted[nr]) continue; // the bulk of the games
+	color = Pairing(nr, n, &w, &b, &dummy);
+	if(!(color ^ matchGame & 1)) { dummy = w; w = b; b = dummy; }
+	CountResult(w, b, standings.counted[nr], -1); // retract old result (e.g. after substitution)
+	CountResult(w, b, result, 1);
+	standings.counted[nr] = result;
+    }
+    matchGame = saveGame; roundNr = saveRound; appData.matchGames = saveGames; // Pairing() alters those
+    return n;
+}
+
+void
+SaveStandings ()
+{   // called whenever results were written, to keep the standings file up to date
+    char *names[MAXPLAYERS];
+    if(!appData.tourneyFile[0] || !UpdateStandings(names)) return;
+    WriteStandings(names);
+    free(names[0]);
+}
+
 char *
 TourneyStandings (int display)
 {
-    int i, w, b, color, wScore, bScore, dummy, nr=0, nPlayers=0;
-    int score[MAXPLAYERS], ranking[MAXPLAYERS], points[MAXPLAYERS], games[MAXPLAYERS];
-    char result, *p, *names[MAXPLAYERS];
+    int i, w, b = 0, bScore, nPlayers, score[MAXPLAYERS], ranking[MAXPLAYERS], points[MAXPLAYERS];
+    char *p, *names[MAXPLAYERS];
 
     if(appData.tourneyType < 0 && !strchr(appData.results, '*'))
 	return strdup(_("Swiss tourney finished")); // standings of Swiss yet TODO
-    names[0] = p = strdup(appData.participants);
-    while(p = strchr(p, '\n')) *p++ = NULLCHAR, names[++nPlayers] = p; // count participants
-
-    for(i=0; i<nPlayers; i++) score[i] = games[i] = 0;
+    if(strchr(appData.results, '*') || strchr(appData.results, ' ')) return strdup("busy"); // tourney not finished
+    if(!(nPlayers = UpdateStandings(names))) return strdup("busy");
 
-    while(result = appData.results[nr]) {
-	color = Pairing(nr, nPlayers, &w, &b, &dummy);
-	if(!(color ^ matchGame & 1)) { dummy = w; w = b; b = dummy; }
-	wScore = bScore = 0;
-	switch(result) {
-	  case '+': wScore = 2; break;
-	  case '-': bScore = 2; break;
-	  case '=': wScore = bScore = 1; break;
-	  case ' ':
-	  case '*': return strdup("busy"); // tourney not finished
-	}
-	score[w] += wScore;
-	score[b] += bScore;
-	games[w]++;
-	games[b]++;
-	nr++;
-    }
-    if(appData.tourneyType > 0) nPlayers = appData.tourneyType; // in gauntlet, list only gauntlet engine(s)
+    for(i=0; i<nPlayers; i++) score[i] = standings.score[i];
+    if(appData.tourneyType > 0 && appData.tourneyType < nPlayers)
+	nPlayers = appData.tourneyType; // in gauntlet, list only gauntlet engine(s)
     for(w=0; w<nPlayers; w++) {
 	bScore = -1;
 	for(i=0; i<nPlayers; i++) if(score[i] > bScore) bScore = score[i], b = i;
 	ranking[w] = b; points[w] = bScore; score[b] = -2;
     }
-    p = malloc(nPlayers*34+1);
+    p = malloc((unsigned) nPlayers*34+1); *p = NULLCHAR; // UpdateStandings() guarantees 2 <= nPlayers <= MAXPLAYERS
     for(w=0; w<nPlayers && w<display; w++)
-	sprintf(p+34*w, "%2d. %5.1f/%-3d %-19.19s\n", w+1, points[w]/2., games[ranking[w]], names[ranking[w]]);
+	sprintf(p+34*w, "%2d. %5.1f/%-3d %-19.19s\n", w+1, points[w]/2., standings.games[ranking[w]], names[ranking[w]]);
     free(names[0]);
     return p;
 }
@@ -8093,6 +8964,19 @@ CompareWithRights (Board b1, Board b2)
     return rights == 0;
 }
 
+static int
+ReversiblePlies (int moveNr)
+{   // [HGM] nr of plies since the last irreversible move, for the 50-move rule
+    int count = moveNr;
+    /* look for last irreversble move */
+    while( (signed char)boards[count][EP_STATUS] <= EP_NONE && count > backwardMostMove )
+        count--;
+    /* if we hit starting position, add initial plies */
+    if( count == backwardMostMove )
+        count -= initialRulePlies;
+    return moveNr - count;
+}
+
 int
 Adjudicate (ChessProgramState *cps)
 {	// [HGM] some adjudications useful with buggy engines
@@ -8239,6 +9123,32 @@ Adjudicate (ChessProgramState *cps)
                      }
                 }
 
+		/* [HGM] egt: decide positions that are in the end-game tables (cursed wins only with 50-move rule) */
+		if(canAdjudicate && appData.adjudicateTablebases) {
+		    int dtz, wdl = EgtProbe(forwardMostMove, &dtz), rule50 = ReversiblePlies(forwardMostMove);
+		    if(wdl*wdl == 4 && appData.ruleMoves > 0) { // a win only counts when it can be converted before the 50-move rule strikes
+			if(dtz < 0) wdl = 13; // not known if it can, so no verdict
+			else if(dtz + rule50 > 2*appData.ruleMoves) wdl /= 2; // it cannot
+		    }
+		    if(wdl < 10 && (wdl*wdl != 1 || appData.ruleMoves > 0)) {
+			static char egtReason[MSG_SIZ];
+			if(wdl*wdl == 4) {
+			    result = (wdl > 0) == WhiteOnMove(forwardMostMove) ? WhiteWins : BlackWins;
+			    if(dtz >= 0) snprintf(egtReason, MSG_SIZ, "Xboard adjudication: tablebase win (DTZ %d)", dtz);
+			    else safeStrCpy(egtReason, "Xboard adjudication: tablebase win", MSG_SIZ);
+			} else {
+			    result = GameIsDrawn;
+			    safeStrCpy(egtReason, "Xboard adjudication: tablebase draw", MSG_SIZ);
+			}
+			if(engineOpponent) {
+			  SendToProgram("force\n", engineOpponent); // suppress reply
+			  SendMoveToProgram(forwardMostMove-1, engineOpponent); /* make sure opponent gets to see last move */
+			}
+			GameEnds( result, egtReason, GE_XBOARD );
+			return 1;
+		    }
+		}
+
                 /* Then some trivial draws (only adjudicate, cannot be claimed) */
                 if(gameInfo.variant == VariantXiangqi ?
                        SufficientDefence(nr, WhitePawn, nrW, nrB) && SufficientDefence(nr, BlackPawn, nrB, nrW)
@@ -8347,14 +9257,7 @@ Adjudicate (ChessProgramState *cps)
                 }
 
                 /* Now we test for 50-move draws. Determine ply count */
-                count = forwardMostMove;
-                /* look for last irreversble move */
-                while( (signed char)boards[count][EP_STATUS] <= EP_NONE && count > backwardMostMove )
-                    count--;
-                /* if we hit starting position, add initial plies */
-                if( count == backwardMostMove )
-                    count -= initialRulePlies;
-                count = forwardMostMove - count;
+                count = ReversiblePlies(forwardMostMove);
 		if(gameInfo.variant == VariantXiangqi && ( count >= 100 || count >= 2*appData.ruleMoves ) ) {
 			// adjust reversible move counter for checks in Xiangqi
 			int i = forwardMostMove - count, inCheck = 0, lastCheck;
@@ -8412,67 +9315,256 @@ Adjudicate (ChessProgramState *cps)
 	return 0;
 }
 
+/* [HGM] egt: end-game tables that XBoard can probe itself. Each format in -egtFormats that has
+ * a loader here is loaded on first use, and then probed for positions with no more men than its
+ * tables cover. Results are kept in a small cache keyed by position, as the same position is probed
+ * for both engines (draw depth) and by the adjudication. When compiled with EGT_MOCK (only done for
+ * the egttest check program) there also is a "mock" format: a text file with lines "wdl dtz FEN".
+ */
+#define EGT_UNKNOWN 100
+#define EGT_CACHE_SIZE 4096
+
+typedef struct {
+    char *format;
+    int (*load) P((char *path)); // returns the largest nr of men covered, or 0 on failure
+    int (*wdl) P((int moveNr));  // -2 (loss) ... 2 (win) for side to move, or EGT_UNKNOWN
+    int (*dtz) P((int moveNr));  // distance to zeroing move, or -1
+    int men;                     // 0 = not loaded yet, -1 = loading failed
+} EgtLoader;
+
+static struct { u64 key; signed char wdl; short dtz; } egtCache[EGT_CACHE_SIZE];
+
 typedef int (CDECL *PPROBE_EGBB) (int player, int *piece, int *square);
 typedef int (CDECL *PLOAD_EGBB) (char *path, int cache_size, int load_options);
 static int egbbCode[] = { 6, 5, 4, 3, 2, 1 };
+static PPROBE_EGBB probeBB;
 
 static int
-BitbaseProbe ()
+LoadScorpio (char *path)
+{
+    char *p, buf[MSG_SIZ];
+    HMODULE lib;
+    PLOAD_EGBB loadBB;
+    safeStrCpy(buf, path, MSG_SIZ);
+    p = buf + strlen(buf);
+    snprintf(p, MSG_SIZ - strlen(buf), "%c%s", SLASH, EGBB_NAME);
+    lib = LoadLibrary(buf);
+    if(!lib) { DisplayError(_("could not load EGBB library"), 0); return 0; }
+    loadBB = (PLOAD_EGBB) GetProcAddress(lib, "load_egbb_xmen");
+    probeBB = (PPROBE_EGBB) GetProcAddress(lib, "probe_egbb_xmen");
+    if(!loadBB || !probeBB) { DisplayError(_("wrong EGBB version"), 0); return 0; }
+    p[1] = NULLCHAR; loadBB(buf, 64*1028, 2); // 2 = SMART_LOAD
+    return 5;
+}
+
+static int
+ProbeScorpio (int moveNr)
 {
     int pieces[10], squares[10], cnt=0, r, f, res;
-    static int loaded;
-    static PPROBE_EGBB probeBB;
-    if(!appData.testLegality) return 10;
-    if(BOARD_HEIGHT != 8 || BOARD_RGHT-BOARD_LEFT != 8) return 12;
-    if(gameInfo.holdingsSize && gameInfo.variant != VariantSuper && gameInfo.variant != VariantSChess) return 12;
-    if(loaded == 2 && forwardMostMove < 2) loaded = 0; // retry on new game
     for(r=0; r<BOARD_HEIGHT; r++) for(f=BOARD_LEFT; f<BOARD_RGHT; f++) {
-	ChessSquare piece = boards[forwardMostMove][r][f];
+	ChessSquare piece = boards[moveNr][r][f];
 	int black = (piece >= BlackPawn);
 	int type = piece - black*BlackPawn;
 	if(piece == EmptySquare) continue;
-	if(type != WhiteKing && type > WhiteQueen) return 12; // unorthodox piece
 	if(type == WhiteKing) type = WhiteQueen + 1;
 	type = egbbCode[type];
 	squares[cnt] = r*(BOARD_RGHT - BOARD_LEFT) + f - BOARD_LEFT;
         pieces[cnt] = type + black*6;
-	if(++cnt > 5) return 11;
+	cnt++;
     }
     pieces[cnt] = squares[cnt] = 0;
-    // probe EGBB
-    if(loaded == 2) return 13; // loading failed before
-    if(loaded == 0) {
-	char *p, *path = strstr(appData.egtFormats, "scorpio:"), buf[MSG_SIZ];
-	HMODULE lib;
-	PLOAD_EGBB loadBB;
-	loaded = 2; // prepare for failure
-	if(!path) return 13; // no egbb installed
-	strncpy(buf, path + 8, MSG_SIZ);
-	if(p = strchr(buf, ',')) *p = NULLCHAR; else p = buf + strlen(buf);
-	snprintf(p, MSG_SIZ - strlen(buf), "%c%s", SLASH, EGBB_NAME);
-	lib = LoadLibrary(buf);
-	if(!lib) { DisplayError(_("could not load EGBB library"), 0); return 13; }
-	loadBB = (PLOAD_EGBB) GetProcAddress(lib, "load_egbb_xmen");
-	probeBB = (PPROBE_EGBB) GetProcAddress(lib, "probe_egbb_xmen");
-	if(!loadBB || !probeBB) { DisplayError(_("wrong EGBB version"), 0); return 13; }
-	p[1] = NULLCHAR; loadBB(buf, 64*1028, 2); // 2 = SMART_LOAD
-	loaded = 1; // success!
-    }
-    res = probeBB(forwardMostMove & 1, pieces, squares);
-    return res > 0 ? 1 : res < 0 ? -1 : 0;
+    res = probeBB(!WhiteOnMove(moveNr), pieces, squares);
+    return res > 0 ? 2 : res < 0 ? -2 : 0;
 }
 
-char *
-SendMoveToBookUser (int moveNr, ChessProgramState *cps, int initial)
-{   // [HGM] book: this routine intercepts moves to simulate book replies
-    char *bookHit = NULL;
+/* Syzygy tables are probed through the Fathom library, which must be installed in the table
+   directory or the library search path */
+typedef unsigned (CDECL *PPROBE_WDL) (u64 white, u64 black, u64 kings, u64 queens, u64 rooks,
+				       u64 bishops, u64 knights, u64 pawns, unsigned ep, int turn);
+typedef unsigned (CDECL *PPROBE_ROOT) (u64 white, u64 black, u64 kings, u64 queens, u64 rooks,
+				        u64 bishops, u64 knights, u64 pawns, unsigned rule50, unsigned ep, int turn, unsigned *results);
+typedef int (CDECL *PINIT_TB) (const char *path);
+static PPROBE_WDL probeWDL;
+static PPROBE_ROOT probeRoot;
 
-    if(cps->drawDepth && BitbaseProbe() == 0) { // [HG} egbb: reduce depth in drawn position
-	char buf[MSG_SIZ];
-	snprintf(buf, MSG_SIZ, "sd %d\n", cps->drawDepth);
-	SendToProgram(buf, cps);
-    }
-    //first determine if the incoming move brings opponent into his book
+static int
+LoadSyzygy (char *path)
+{
+    char buf[MSG_SIZ];
+    HMODULE lib;
+    PINIT_TB initTB;
+    unsigned *largest;
+    snprintf(buf, MSG_SIZ, "%s%c%s", path, SLASH, SYZYGY_NAME);
+    if(!(lib = LoadLibrary(buf)) && !(lib = LoadLibrary(SYZYGY_NAME))) {
+	DisplayError(_("could not load Syzygy probing library"), 0); return 0;
+    }
+    initTB = (PINIT_TB) GetProcAddress(lib, "tb_init");
+    probeWDL = (PPROBE_WDL) GetProcAddress(lib, "tb_probe_wdl_impl");
+    probeRoot = (PPROBE_ROOT) GetProcAddress(lib, "tb_probe_root_impl");
+    largest = (unsigned *) GetProcAddress(lib, "TB_LARGEST");
+    if(!initTB || !probeWDL || !probeRoot || !largest) { DisplayError(_("wrong Syzygy probing library"), 0); return 0; }
+    if(!initTB(path) || *largest == 0) { DisplayError(_("no Syzygy tables found"), 0); return 0; }
+    return *largest;
+}
+
+static int
+SyzygyArgs (int moveNr, u64 *bb, unsigned *ep)
+{   // bit boards white, black, kings, queens, rooks, bishops, knights, pawns; FALSE if tables do not apply
+    static int index[] = { 7, 6, 5, 4, 3, 2 }; // Pawn ... King
+    int r, f, e = (signed char) boards[moveNr][EP_STATUS];
+    for(r=0; r<8; r++) bb[r] = 0;
+    for(r=0; r<6; r++) if(boards[moveNr][CASTLING][r] != NoRights) { // castling still possible?
+	if(r == 2 || r == 5) continue;
+	if(boards[moveNr][CASTLING][r < 2 ? 2 : 5] != NoRights) return FALSE;
+    }
+    for(r=0; r<BOARD_HEIGHT; r++) for(f=BOARD_LEFT; f<BOARD_RGHT; f++) {
+	ChessSquare piece = boards[moveNr][r][f];
+	int black = (piece >= BlackPawn);
+	u64 bit = (u64)1 << (8*r + f - BOARD_LEFT);
+	if(piece == EmptySquare) continue;
+	bb[black] |= bit;
+	bb[index[piece - black*BlackPawn]] |= bit;
+    }
+    *ep = 0;
+    if(e >= BOARD_LEFT && e < BOARD_RGHT) { // e.p. capture only counts when there is a Pawn to make it (as in the book key)
+	int rank = WhiteOnMove(moveNr) ? 4 : 3, pawn = WhiteOnMove(moveNr) ? WhitePawn : BlackPawn;
+	if(e > BOARD_LEFT && boards[moveNr][rank][e-1] == pawn || e < BOARD_RGHT-1 && boards[moveNr][rank][e+1] == pawn)
+	    *ep = 8*(WhiteOnMove(moveNr) ? 5 : 2) + e - BOARD_LEFT;
+    }
+    return TRUE;
+}
+
+static int
+ProbeSyzygy (int moveNr)
+{
+    u64 bb[8];
+    unsigned ep, res;
+    if(!SyzygyArgs(moveNr, bb, &ep)) return EGT_UNKNOWN;
+    res = probeWDL(bb[0], bb[1], bb[2], bb[3], bb[4], bb[5], bb[6], bb[7], ep, WhiteOnMove(moveNr));
+    return res == 0xFFFFFFFF ? EGT_UNKNOWN : (int) res - 2; // TB_LOSS = 0 ... TB_WIN = 4
+}
+
+static int
+ProbeSyzygyDTZ (int moveNr)
+{
+    u64 bb[8];
+    unsigned ep, res;
+    if(!SyzygyArgs(moveNr, bb, &ep)) return -1;
+    res = probeRoot(bb[0], bb[1], bb[2], bb[3], bb[4], bb[5], bb[6], bb[7], ReversiblePlies(moveNr), ep, WhiteOnMove(moveNr), NULL);
+    return res == 0xFFFFFFFF ? -1 : (int) (res >> 20); // TB_RESULT_DTZ_MASK
+}
+
+#ifdef EGT_MOCK
+typedef struct { Board board; int btm, wdl, dtz; } MockEntry;
+static MockEntry *mockTable;
+static int mockSize;
+
+static int
+LoadMock (char *path)
+{
+    FILE *f = fopen(path, "r");
+    char line[MSG_SIZ];
+    int wdl, dtz, n;
+    if(!f) { DisplayError(_("could not open mock tablebase"), errno); return 0; }
+    while(fgets(line, MSG_SIZ, f)) {
+	if(sscanf(line, "%d %d %n", &wdl, &dtz, &n) < 2) continue;
+	mockTable = (MockEntry *) realloc(mockTable, (mockSize + 1) * sizeof(MockEntry));
+	if(!ParseFEN(mockTable[mockSize].board, &mockTable[mockSize].btm, line + n, FALSE)) continue;
+	mockTable[mockSize].wdl = wdl; mockTable[mockSize++].dtz = dtz;
+    }
+    fclose(f);
+    return 32;
+}
+
+static MockEntry *
+FindMock (int moveNr)
+{
+    int i;
+    for(i=0; i<mockSize; i++)
+	if(mockTable[i].btm == !WhiteOnMove(moveNr) && CompareBoards(mockTable[i].board, boards[moveNr])) return &mockTable[i];
+    return NULL;
+}
+
+static int
+ProbeMock (int moveNr)
+{
+    MockEntry *m = FindMock(moveNr);
+    return m ? m->wdl : EGT_UNKNOWN;
+}
+
+static int
+ProbeMockDTZ (int moveNr)
+{
+    MockEntry *m = FindMock(moveNr);
+    return m ? m->dtz : -1;
+}
+#endif
+
+static EgtLoader egtLoaders[] = {
+  { "syzygy:", LoadSyzygy, ProbeSyzygy, ProbeSyzygyDTZ },
+  { "scorpio:", LoadScorpio, ProbeScorpio, NULL },
+#ifdef EGT_MOCK
+  { "mock:", LoadMock, ProbeMock, ProbeMockDTZ },
+#endif
+  { NULL }
+};
+
+static int
+EgtProbe (int moveNr, int *dtz)
+{   // WDL of the position from the first table that has it, -2 ... 2 for the side to move, or >= 10 if unknown
+    int cnt = 0, r, f, i, res = 13;
+    u64 key;
+    EgtLoader *egt;
+
+    if(dtz) *dtz = -1;
+    if(!appData.testLegality) return 10;
+    if(BOARD_HEIGHT != 8 || BOARD_RGHT-BOARD_LEFT != 8) return 12;
+    if(gameInfo.holdingsSize && gameInfo.variant != VariantSuper && gameInfo.variant != VariantSChess) return 12;
+    for(r=0; r<BOARD_HEIGHT; r++) for(f=BOARD_LEFT; f<BOARD_RGHT; f++) {
+	ChessSquare piece = boards[moveNr][r][f];
+	int type = piece - (piece >= BlackPawn)*BlackPawn;
+	if(piece == EmptySquare) continue;
+	if(type != WhiteKing && type > WhiteQueen) return 12; // unorthodox piece
+	if(++cnt > 7) return 11;
+    }
+    key = PositionKey(moveNr) | 1; // never 0, which marks an empty entry
+    i = key & (EGT_CACHE_SIZE - 1);
+    if(egtCache[i].key == key) {
+	res = egtCache[i].wdl;
+	if(!dtz || res*res != 4 || egtCache[i].dtz >= 0) {
+	    if(dtz) *dtz = egtCache[i].dtz;
+	    return res;
+	}
+    }
+    for(egt = egtLoaders; egt->format; egt++) {
+	if(egt->men < 0 && forwardMostMove < 2) egt->men = 0; // retry on new game
+	if(egt->men == 0) {
+	    char *p, *path = strstr(appData.egtFormats, egt->format), buf[MSG_SIZ];
+	    egt->men = -1; // prepare for failure
+	    if(!path) continue; // not installed
+	    safeStrCpy(buf, path + strlen(egt->format), MSG_SIZ);
+	    if(p = strchr(buf, ',')) *p = NULLCHAR;
+	    if(!(egt->men = egt->load(buf))) egt->men = -1;
+	}
+	if(cnt > egt->men || (res = egt->wdl(moveNr)) == EGT_UNKNOWN) { res = 13; continue; }
+	if(dtz && res*res == 4 && egt->dtz) *dtz = egt->dtz(moveNr);
+	break;
+    }
+    egtCache[i].key = key; egtCache[i].wdl = res; egtCache[i].dtz = (dtz ? *dtz : -1);
+    return res;
+}
+
+char *
+SendMoveToBookUser (int moveNr, ChessProgramState *cps, int initial)
+{   // [HGM] book: this routine intercepts moves to simulate book replies
+    char *bookHit = NULL;
+
+    if(cps->drawDepth && EgtProbe(forwardMostMove, NULL) == 0) { // [HG} egbb: reduce depth in drawn position
+	char buf[MSG_SIZ];
+	snprintf(buf, MSG_SIZ, "sd %d\n", cps->drawDepth);
+	SendToProgram(buf, cps);
+    }
+    //first determine if the incoming move brings opponent into his book
     if(appData.usePolyglotBook && (cps == &first ? !appData.firstHasOwnBookUCI : !appData.secondHasOwnBookUCI))
 	bookHit = ProbeBook(moveNr+1, appData.polyglotBook); // returns move
     if(appData.debugMode) fprintf(debugFP, "book hit = %s\n", bookHit ? bookHit : "(NULL)");
@@ -8779,9 +9871,11 @@ FakeBookMove: // [HGM] book: we jump here to simulate machine moves after book h
         /* [AS] Save move info*/
         pvInfoList[ forwardMostMove ].score = programStats.score;
         pvInfoList[ forwardMostMove ].depth = programStats.depth;
-        pvInfoList[ forwardMostMove ].time =  programStats.time; // [HGM] PGNtime: take time from engine stats
+        pvInfoList[ forwardMostMove ].time =  10*programStats.time; // [HGM] PGNtime: take time from engine stats (centi-sec)
 
+	if(lineReader == cps) lagMover = cps; // lag: tell SwitchClocks this move was just read from the engine (so not a book move)
 	MakeMove(fromX, fromY, toX, toY, promoChar);/*updates forwardMostMove*/
+	lagMover = NULL;
 
         /* Test suites abort the 'game' after one move */
         if(*appData.finger) {
@@ -8878,6 +9972,13 @@ FakeBookMove: // [HGM] book: we jump here to simulate machine moves after book h
 		SendToProgram("go\n", cps->other);
 	    }
 	    cps->other->maybeThinking = TRUE;
+	    if(lineReader == cps) { // lag: opponent now has the move
+		TimeMark now; double lag; LagStats *l = &lagStats[!WhiteOnMove(forwardMostMove-1)];
+		GetTimeMark(&now);
+		lag = SubtractTimeMarksMicro(&now, &lineReadTM);
+		l->relays++; l->relaySum += lag;
+		if(lag > l->relayMax) l->relayMax = lag;
+	    }
 	}
 
 	roar = (killX >= 0 && IS_LION(boards[forwardMostMove][toY][toX]));
@@ -9603,8 +10704,11 @@ FakeBookMove: // [HGM] book: we jump here to simulate machine moves after book h
 		    tempStats.line_is_book = 0;
 		}
 
-		    if(tempStats.score != 0 || tempStats.nodes != 0 || tempStats.time != 0)
+		    if(tempStats.score != 0 || tempStats.nodes != 0 || tempStats.time != 0) {
 			programStats = tempStats; // [HGM] info: only set stats if genuine PV and not an info line
+			if(cps == &first && (gameMode == AnalyzeMode || gameMode == AnalyzeFile) && !tempStats.line_is_book)
+			    CacheAnalysis(currentMove, &tempStats);
+		    }
 
                 SendProgramStatsToFrontend( cps, &tempStats );
 
@@ -9927,6 +11031,10 @@ ParseGameHistory (char *game)
 	    backwardMostMove = blackPlaysFirst ? 1 : 0;
 	    return;
 	}
+	if (boardIndex+1 > framePtr && !GrowGameStorage(boardIndex+1)) {
+	    DisplayError(_("Game too long; out of memory"), 0);
+	    return;
+	}
 	(void) CoordsToAlgebraic(boards[boardIndex], PosFlags(boardIndex),
 				 fromY, fromX, toY, toX, promoChar,
 				 parseList[boardIndex]);
@@ -10386,8 +11494,8 @@ MakeMove (int fromX, int fromY, int toX, int toY, int promoChar)
         fflush(serverMoves);
     }
 
-    if (forwardMostMove+1 > framePtr) { // [HGM] vari: do not run into saved variations..
-	GameEnds(GameUnfinished, _("Game too long; increase MAX_MOVES and recompile"), GE_XBOARD);
+    if (forwardMostMove+1 > framePtr && !GrowGameStorage(forwardMostMove+1)) { // [HGM] vari: do not run into saved variations..
+	GameEnds(GameUnfinished, _("Game too long; out of memory"), GE_XBOARD);
       return;
     }
     UnLoadPV(); // [HGM] pv: if we are looking at a PV, abort this
@@ -10855,6 +11963,7 @@ Substitute (char *participants, int expunge)
 	    if(appData.tourneyFile[0] && (f = fopen(appData.tourneyFile, "r+")) ) {
 		flock(fileno(f), LOCK_EX);
 		ParseArgsFromFile(f);
+		if(MapTourneySlots()) SlotsToResults();
 		fseek(f, 0, SEEK_SET);
 		FREE(appData.participants); appData.participants = participants;
 		if(expunge) { // erase results of replaced engine
@@ -10871,6 +11980,7 @@ Substitute (char *participants, int expunge)
 			Pairing(i, nPlayers, &w, &b, &dummy);
 			if(w == changed || b == changed) appData.results[i] = ' '; // mark as not played
 		    }
+		    if(slots) for(i=0; i<len; i++) if(appData.results[i] == ' ') slots[i] = ' ';
 		}
 		WriteTourneyFile(appData.results, f);
 		fclose(f); // release lock
@@ -10909,6 +12019,7 @@ int
 CreateTourney (char *name)
 {
 	FILE *f;
+	char buf[MSG_SIZ];
 	if(matchMode && strcmp(name, appData.tourneyFile)) {
 	     ASSIGN(name, appData.tourneyFile); //do not allow change of tourneyfile while playing
 	}
@@ -10917,6 +12028,7 @@ CreateTourney (char *name)
 		DisplayError(_("You must supply a tournament file,\nfor storing the tourney progress"), 0);
 	    return 0;
 	}
+	tourneySignature = 0; // force parsing for the first game
 	f = fopen(name, "r");
 	if(f) { // file exists
 	    ASSIGN(appData.tourneyFile, name);
@@ -10931,6 +12043,8 @@ CreateTourney (char *name)
 	    ASSIGN(appData.tourneyFile, name);
 	    if(appData.tourneyType < 0) appData.defaultMatchGames = 1; // Swiss forces games/pairing = 1
 	    if((f = WriteTourneyFile("", NULL)) == NULL) return 0;
+	    snprintf(buf, MSG_SIZ, "%s.slots", name); unlink(buf); // a fresh tourney must not inherit results
+	    UnmapTourneySlots();
 	}
 	fclose(f);
 	appData.noChessProgram = FALSE;
@@ -11038,6 +12152,7 @@ SetPlayer (int player, char *p)
     engineName = strdup(p); if(p = strchr(engineName, '\n')) *p = NULLCHAR;
     for(i=1; command[i]; i++) if(!strcmp(mnemonic[i], engineName)) break;
     if(mnemonic[i]) {
+	tourneySignature = 0; // engine line can alter options of the tourney file, which must then be parsed again
 	snprintf(buf, MSG_SIZ, "-fcp %s", command[i]);
 	ParseArgsFromString(resetOptions); appData.fenOverride[0] = NULL; appData.pvSAN[0] = FALSE;
 	appData.firstHasOwnBookUCI = !appData.defNoBook; appData.protocolVersion[0] = PROTOVER;
@@ -11119,6 +12234,32 @@ Pairing (int nr, int nPlayers, int *whitePlayer, int *blackPlayer, int *syncInte
     return curRound & 1;
 }
 
+static char *pairingResults, *pairingTourney; // what the pairing engine knows, and of which tourney
+
+static void
+SendResultsToPairingEngine (int nPlayers)
+{   // send only the changes since last time, if the pairing engine supports that, or the complete results otherwise
+    char buf[1<<16];
+    int i, len, old;
+    if(!pairingTourney || strcmp(pairingTourney, appData.tourneyFile)) { // other tourney: engine must get everything anew
+	FREE(pairingResults); pairingResults = NULL;
+	ASSIGN(pairingTourney, appData.tourneyFile);
+    }
+    len = strlen(appData.results), old = (pairingResults ? strlen(pairingResults) : 0);
+    if(pairing.resultDeltas && pairingResults) {
+	for(i=0; i<len || i<old; i++) {
+	    char c = (i < len ? appData.results[i] : ' '), o = (i < old ? pairingResults[i] : ' ');
+	    if(c == o) continue;
+	    snprintf(buf, MSG_SIZ, "pairing-result %d %c\n", i+1, c == ' ' ? '_' : c);
+	    SendToProgram(buf, &pairing);
+	}
+    } else {
+	snprintf(buf, 1<<16, "results %d %s\n", nPlayers, appData.results);
+	SendToProgram(buf, &pairing);
+    }
+    ASSIGN(pairingResults, appData.results);
+}
+
 int
 NextTourneyGame (int nr, int *swapColors)
 {   // !!!major kludge!!! fiddle appData settings to get everything in order for next tourney game
@@ -11126,9 +12267,14 @@ NextTourneyGame (int nr, int *swapColors)
     int whitePlayer, blackPlayer, firstBusy=1000000000, syncInterval = 0, nPlayers, OK = 1;
     FILE *tf;
     if(appData.tourneyFile[0] == NULLCHAR) return 1; // no tourney, always allow next game
+    if(waitingForGame && slots && FirstBusySlot()/waitInterval < nextGame/waitInterval) { // still waiting; no need to parse anything
+	WaitForTourneyChange();
+	return 0;
+    }
     tf = fopen(appData.tourneyFile, "r");
     if(tf == NULL) { DisplayFatalError(_("Bad tournament file"), 0, 1); return 0; }
-    ParseArgsFromFile(tf); fclose(tf);
+    ParseTourneyFile(tf); fclose(tf); // skipped when unchanged; SetPlayer() below forces the next one
+    SlotsToResults(); // -results in tourney file might be outdated
     InitTimeControls(); // TC might be altered from tourney file
 
     nPlayers = CountPlayers(appData.participants); // count participants
@@ -11140,8 +12286,8 @@ NextTourneyGame (int nr, int *swapColors)
 	while(*q) if(*q++ == '*' || q[-1] == ' ') { firstBusy = q - p - 1; break; }
 	if(firstBusy/syncInterval < (nextGame/syncInterval)) {
 	    DisplayMessage(_("Waiting for other game(s)"),"");
-	    waitingForGame = TRUE;
-	    ScheduleDelayedEvent(NextMatchGame, 1000); // wait for all games of previous round to finish
+	    waitingForGame = TRUE; waitInterval = syncInterval;
+	    WaitForTourneyChange(); // wait for all games of previous round to finish
 	    return 0;
 	}
 	waitingForGame = FALSE;
@@ -11155,10 +12301,11 @@ NextTourneyGame (int nr, int *swapColors)
 		    DisplayFatalError(_("No pairing engine specified"), 0, 1);
 		    return 0;
 		}
+		pairing.resultDeltas = FALSE; // until the new engine announces it
 		StartChessProgram(&pairing); // starts the pairing engine
+		FREE(pairingResults); pairingResults = NULL;
 	    }
-	    snprintf(buf, 1<<16, "results %d %s\n", nPlayers, appData.results);
-	    SendToProgram(buf, &pairing);
+	    SendResultsToPairingEngine(nPlayers);
 	    snprintf(buf, 1<<16, "pairing %d\n", nr+1);
 	    SendToProgram(buf, &pairing);
 	    return 0; // wait for pairing engine to answer (which causes NextTourneyGame to be called again...
@@ -11198,7 +12345,7 @@ NextMatchGame ()
 	char buf[MSG_SIZ];
 	snprintf(buf, MSG_SIZ, appData.nameOfDebugFile, nextGame+1); // expand name of debug file with %d in it
 	if(strcmp(buf, currentDebugFile)) { // name has changed
-	    FILE *f = fopen(buf, "w");
+	    FILE *f = OpenDebugFile(buf);
 	    if(f) { // if opening the new file failed, just keep using the old one
 		ASSIGN(currentDebugFile, buf);
 		fclose(debugFP);
@@ -11206,7 +12353,7 @@ NextMatchGame ()
 	    }
 	    if(appData.serverFileName) {
 		if(serverFP) fclose(serverFP);
-		serverFP = fopen(appData.serverFileName, "w");
+		serverFP = OpenDebugFile(appData.serverFileName);
 		if(serverFP && first.pr != NoProc) fprintf(serverFP, "StartChildProcess (dir=\".\") .\\%s\n", first.tidy);
 		if(serverFP && second.pr != NoProc) fprintf(serverFP, "StartChildProcess (dir=\".\") .\\%s\n", second.tidy);
 	    }
@@ -11217,6 +12364,7 @@ NextMatchGame ()
     first.twoMachinesColor =  firstWhite ? "white\n" : "black\n";   // perform actual color assignement
     second.twoMachinesColor = firstWhite ? "black\n" : "white\n";
     appData.noChessProgram = (first.pr == NoProc); // kludge to prevent Reset from starting up chess program
+    PreloadOpenings(); // parses the opening file on the first game, so that it consumes no random numbers after seeding
     if(appData.loadGameIndex == -2) srandom(appData.seedBase + 68163*(nextGame & ~1)); // deterministic seed to force same opening
     Reset(FALSE, first.pr != NoProc);
     res = LoadGameOrPosition(matchGame); // setup game
@@ -11271,7 +12419,7 @@ void
 GameEnds (ChessMove result, char *resultDetails, int whosays)
 {
     GameMode nextGameMode;
-    int isIcsGame;
+    int isIcsGame, i;
     char buf[MSG_SIZ], popupRequested = 0, *ranking = NULL;
 
     if(endingGame) return; /* [HGM] crash: forbid recursion */
@@ -11283,6 +12431,10 @@ GameEnds (ChessMove result, char *resultDetails, int whosays)
     if (appData.debugMode) {
       fprintf(debugFP, "GameEnds(%d, %s, %d)\n",
 	      result, resultDetails ? resultDetails : "(null)", whosays);
+      for(i=0; i<2; i++) if(lagStats[i].moves) // lag: report GUI overhead on engine moves
+	fprintf(debugFP, "%s GUI lag: %d moves, clock stop avg %.3f max %.3f msec, relay avg %.3f max %.3f msec, credited %ld msec\n",
+		i ? "Black" : "White", lagStats[i].moves, lagStats[i].stopSum/lagStats[i].moves/1000., lagStats[i].stopMax/1000.,
+		lagStats[i].relays ? lagStats[i].relaySum/lagStats[i].relays/1000. : 0., lagStats[i].relayMax/1000., lagStats[i].credited);
     }
 
     fromX = fromY = killX = killY = -1; // [HGM] abort any move the user is entering. // [HGM] lion
@@ -11587,7 +12739,7 @@ GameEnds (ChessMove result, char *resultDetails, int whosays)
     }
 
     if (matchMode && (gameMode == TwoMachinesPlay || (waitingForGame || startingEngine) && exiting)) {
-	char resChar = '=';
+	char resChar = '='; int sprt = 0;
         switch (result) {
 	case WhiteWins:
 	  resChar = '+';
@@ -11617,7 +12769,14 @@ GameEnds (ChessMove result, char *resultDetails, int whosays)
 	    ReserveGame(nextGame, resChar); // sets nextGame
 	    if(nextGame > appData.matchGames) appData.tourneyFile[0] = 0, ranking = TourneyStandings(3); // tourney is done
 	    else ranking = strdup("busy"); //suppress popup when aborted but not finished
-	} else roundNr = nextGame = matchGame + 1; // normal match, just increment; round equals matchGame
+	} else {
+	    roundNr = nextGame = matchGame + 1; // normal match, just increment; round equals matchGame
+	    if(resChar != ' ') { // sprt: score from the viewpoint of the first engine
+		MatchStatsAdd(resChar == '=' ? 1 : (resChar == '+') == (first.twoMachinesColor[0] == 'w') ? 2 : 0);
+		if(appData.sprtStop && (sprt = MatchStatsSPRT()) && nextGame <= appData.matchGames)
+		    appData.matchGames = matchGame; // SPRT terminated; this was the last game
+	    }
+	}
 
 	if (nextGame <= appData.matchGames && !abortMatch) {
 	    gameMode = nextGameMode;
@@ -11632,6 +12791,8 @@ GameEnds (ChessMove result, char *resultDetails, int whosays)
 		     first.tidy, second.tidy,
 		     first.matchWins, second.matchWins,
 		     appData.matchGames - (first.matchWins + second.matchWins));
+	    if(sprt) snprintf(buf + strlen(buf), MSG_SIZ - strlen(buf), " (%s)",
+			      sprt > 0 ? _("SPRT accepted H1") : _("SPRT accepted H0"));
 	    if(!appData.tourneyFile[0]) matchGame++, DisplayTwoMachinesTitle(); // [HGM] update result in window title
 	    if(ranking && strcmp(ranking, "busy") && appData.afterTourney && appData.afterTourney[0]) RunCommand(appData.afterTourney);
 	    popupRequested++; // [HGM] crash: postpone to after resetting endingGame
@@ -11774,6 +12935,7 @@ Reset (int redraw, int init)
     ics_gamenum = -1;
     white_holding[0] = black_holding[0] = NULLCHAR;
     ClearProgramStats();
+    memset(lagStats, 0, sizeof(lagStats));
     opponentKibitzes = FALSE; // [HGM] kibitz: do not reserve space in engine-output window in zippy mode
 
     ResetFrontEnd();
@@ -11805,7 +12967,7 @@ Reset (int redraw, int init)
     currentMove = forwardMostMove = backwardMostMove = 0;
     MarkTargetSquares(1);
     InitPosition(redraw);
-    for (i = 0; i < MAX_MOVES; i++) {
+    for (i = 0; i < maxMoves; i++) {
 	if (commentList[i] != NULL) {
 	    free(commentList[i]);
 	    commentList[i] = NULL;
@@ -11834,6 +12996,8 @@ AutoPlayGameLoop ()
     for (;;) {
 	if (!AutoPlayOneMove())
 	  return;
+	if (ShowCachedAnalysis())
+	  continue; // analysis of this position is already known
 	if (matchMode || appData.timeDelay == 0)
 	  continue;
 	if (appData.timeDelay < 0)
@@ -12165,6 +13329,7 @@ LoadGameOneMove (ChessMove readAhead)
 	/* currentMoveString is set as a side-effect of yylex */
 
 	thinkOutput[0] = NULLCHAR;
+	RecordOpeningMove(fromX, fromY, toX, toY, promoChar);
 	MakeMove(fromX, fromY, toX, toY, promoChar);
 	killX = killY = -1; // [HGM] lion: used up
 	currentMove = forwardMostMove;
@@ -12183,7 +13348,7 @@ LoadGameFromFile (char *filename, int n, char *title, int useList)
 	f = stdin;
 	title = "stdin";
     } else {
-	f = fopen(filename, "rb");
+	f = OpenPGNFile(filename, "rb");
 	if (f == NULL) {
 	  snprintf(buf, sizeof(buf),  _("Can't open \"%s\""), filename);
 	    DisplayError(buf, errno);
@@ -12727,7 +13892,193 @@ GameContainsPosition (FILE *f, ListGame *lg)
     }
 }
 
+// opening explorer: tally the continuations played from every position in the first moves of the cached games
+
+typedef struct {
+    u64 key;
+    int next, games, points, decided, rated;
+    unsigned char from, to, promo, castle;
+    double ratingSum;
+} ExplorerEntry;
+
+static ExplorerEntry *explorer;
+static int *explorerHash, explorerMask, nrOfExplorer, maxExplorer;
+static u64 *explorerKeys;
+static unsigned int explorerMovePtr;
+static int explorerGames, explorerVariant = -1;
+
+#define EXPLORER_KEY(type, sq) explorerKeys[(type)*256 + (sq)]
+
+static void
+ExplorerRehash (int size)
+{
+    int i, h;
+    explorerMask = size - 1;
+    explorerHash = (int *) realloc(explorerHash, size * sizeof(int));
+    for(i=0; i<size; i++) explorerHash[i] = -1;
+    for(i=0; i<nrOfExplorer; i++) {
+	h = explorer[i].key & explorerMask;
+	explorer[i].next = explorerHash[h]; explorerHash[h] = i;
+    }
+}
+
+static void
+ExplorerTally (u64 key, int from, int to, int promo, int castle, ListGame *lg, int black)
+{
+    ExplorerEntry *e;
+    int i, h = key & explorerMask, rating;
+
+    for(i = explorerHash[h]; i >= 0; i = explorer[i].next) {
+	e = &explorer[i];
+	if(e->key == key && e->from == from && e->to == to && e->promo == promo && e->castle == castle) break;
+    }
+    if(i < 0) { // first time this move is seen in this position
+	if(nrOfExplorer >= maxExplorer) {
+	    explorer = (ExplorerEntry *) realloc(explorer, (maxExplorer = 2*maxExplorer + 4096) * sizeof(ExplorerEntry));
+	    if(explorer == NULL) { maxExplorer = nrOfExplorer = 0; return; }
+	}
+	e = &explorer[i = nrOfExplorer++];
+	memset(e, 0, sizeof(ExplorerEntry));
+	e->key = key; e->from = from; e->to = to; e->promo = promo; e->castle = castle;
+	e->next = explorerHash[h]; explorerHash[h] = i;
+	if(nrOfExplorer > explorerMask) ExplorerRehash(2*(explorerMask + 1)), e = &explorer[i];
+    }
+    e->games++;
+    switch(lg->gameInfo.result) { // points in half-points for the side that played the move
+      case WhiteWins:   e->points += 2*!black; e->decided++; break;
+      case BlackWins:   e->points += 2*black;  e->decided++; break;
+      case GameIsDrawn: e->points++;           e->decided++; break;
+      default: break;
+    }
+    rating = black ? lg->gameInfo.blackRating : lg->gameInfo.whiteRating;
+    if(rating > 0) e->rated++, e->ratingSum += rating;
+}
+
+static void
+ExplorerAddGame (Board board, int btm, Move *move, ListGame *lg)
+{   // replay the packed game like QuickScan does, and tally each move with the key of the position it was played in
+    int r, f, ply, plies = 2*appData.explorerDepth;
+    u64 key = btm ? EXPLORER_KEY(EmptySquare, 0) : 0;
+
+    MakePieceList(board, counts);
+    for(r=0; r<BOARD_HEIGHT; r++) for(f=BOARD_LEFT; f<BOARD_RGHT; f++)
+	if(board[r][f] != EmptySquare) key ^= EXPLORER_KEY(board[r][f], f + (r<<4));
+    for(ply=0; ply<plies && move->piece; ply++, move++) {
+	int piece = move->piece, to = move->to, from, promo = 0, castle = 0, capture = -1;
+	if(piece == Q_PROMO) { // (Q_PROMO, to) + (piece, promoType)
+	    piece = (++move)->piece; promo = move->to;
+	} else if(piece == Q_EP) { // (Q_EP, ep-sqr) + (piece, to)
+	    capture = to;
+	    piece = (++move)->piece; to = move->to;
+	} else if(piece <= Q_BCASTL) { // (Q_XCASTL, king-to) + (rook, rook-to)
+	    int king = pieceList[piece], rook = (++move)->piece, rookFrom = pieceList[rook];
+	    from = pieceList[king];
+	    castle = (rookFrom > from) + 1; // 2 = King side
+	    ExplorerTally(key, from, to, 0, castle, lg, btm);
+	    key ^= EXPLORER_KEY(pieceType[king], from) ^ EXPLORER_KEY(pieceType[king], to);
+	    key ^= EXPLORER_KEY(pieceType[rook], rookFrom) ^ EXPLORER_KEY(pieceType[rook], move->to);
+	    quickBoard[from] = quickBoard[rookFrom] = 0;
+	    quickBoard[to] = king; pieceList[king] = to;
+	    quickBoard[move->to] = rook; pieceList[rook] = move->to;
+	    key ^= EXPLORER_KEY(EmptySquare, 0); btm = !btm;
+	    continue;
+	}
+	from = pieceList[piece];
+	ExplorerTally(key, from, to, promo, 0, lg, btm);
+	if(capture < 0 && quickBoard[to]) capture = to;
+	if(capture >= 0) key ^= EXPLORER_KEY(pieceType[quickBoard[capture]], capture), quickBoard[capture] = 0;
+	key ^= EXPLORER_KEY(pieceType[piece], from);
+	if(promo) pieceType[piece] = promo;
+	key ^= EXPLORER_KEY(pieceType[piece], to);
+	quickBoard[from] = 0; quickBoard[to] = piece; pieceList[piece] = to;
+	key ^= EXPLORER_KEY(EmptySquare, 0); btm = !btm;
+    }
+}
+
+static void
+BuildExplorer ()
+{   // (re)index the first moves of all cached games of the current variant in the game list
+    ListGame *lg;
+    Board board;
+    int i, btm;
+
+    if(!explorerKeys) { // from a private xorshift generator, so that the random() sequence of a seeded match is not disturbed
+	u64 x = u64Const(0x9E3779B97F4A7C15);
+	explorerKeys = (u64 *) malloc((EmptySquare+1) * 256 * sizeof(u64));
+	for(i=0; i<(EmptySquare+1)*256; i++)
+	    x ^= x << 13, x ^= x >> 7, x ^= x << 17, explorerKeys[i] = x;
+    }
+    nrOfExplorer = explorerGames = 0;
+    ExplorerRehash(1<<16);
+    for(lg = (ListGame *) gameList.head; lg->node.succ; lg = (ListGame *) lg->node.succ) {
+	explorerGames++;
+	if(!lg->moves || lg->gameInfo.variant != gameInfo.variant) continue;
+	btm = 0;
+	if(lg->gameInfo.fen) { if(!ParseFEN(board, &btm, lg->gameInfo.fen, FALSE)) continue; }
+	else CopyBoard(board, initialPosition);
+	ExplorerAddGame(board, btm, &moveDatabase[lg->moves], lg);
+    }
+    explorerMovePtr = movePtr; explorerVariant = gameInfo.variant;
+}
+
+static int
+CompareExplorer (const void *a, const void *b)
+{
+    return explorer[*(int *)b].games - explorer[*(int *)a].games;
+}
+
+char *
+ExplorerText (int moveNr)
+{   // list the moves played from the given position in the game list, with count, score and average rating
+    int i, n = 0, r, f, *found = NULL, maxFound = 0;
+    u64 key;
+    char *p, buf[MSG_SIZ], move[MOVE_LEN], elo[20];
+    ListGame *lg;
+
+    if(ListEmpty(&gameList)) return StrSave(_("no game list loaded"));
+    if(gameInfo.holdingsWidth) return StrSave(_("not available in variants with piece drops"));
+    for(i=0, lg = (ListGame *) gameList.head; lg->node.succ; lg = (ListGame *) lg->node.succ) i++;
+    if(movePtr != explorerMovePtr || i != explorerGames || gameInfo.variant != explorerVariant) BuildExplorer();
+    key = WhiteOnMove(moveNr) ? 0 : EXPLORER_KEY(EmptySquare, 0);
+    for(r=0; r<BOARD_HEIGHT; r++) for(f=BOARD_LEFT; f<BOARD_RGHT; f++)
+	if(boards[moveNr][r][f] != EmptySquare) key ^= EXPLORER_KEY(boards[moveNr][r][f], f + (r<<4));
+    for(i = explorerHash[key & explorerMask]; i >= 0; i = explorer[i].next) {
+	ExplorerEntry *e = &explorer[i];
+	if(e->key != key || boards[moveNr][e->from>>4][e->from&15] == EmptySquare) continue; // (guard against key collisions)
+	if(n >= maxFound) found = (int *) realloc(found, (maxFound = 2*maxFound + 32) * sizeof(int));
+	found[n++] = i;
+    }
+    if(n == 0) return StrSave(_("position not found in game list"));
+    qsort(found, n, sizeof(int), CompareExplorer);
+    p = (char *) malloc(n * MSG_SIZ); *p = NULLCHAR;
+    for(i=0; i<n; i++) {
+	ExplorerEntry *e = &explorer[found[i]];
+	if(e->castle) safeStrCpy(move, e->castle == 2 ? "O-O" : "O-O-O", MOVE_LEN);
+	else CoordsToAlgebraic(boards[moveNr], PosFlags(moveNr), e->from>>4, e->from&15, e->to>>4, e->to&15,
+			       e->promo ? ToLower(PieceToChar((ChessSquare) e->promo)) : NULLCHAR, move);
+	if(e->rated) snprintf(elo, 20, "%4d", (int) (e->ratingSum/e->rated + 0.5)); else safeStrCpy(elo, "   -", 20);
+	if(e->decided) snprintf(buf, MSG_SIZ, "%6d %5.1f%% %s %s\n", e->games, 50.*e->points/e->decided, elo, move);
+	else snprintf(buf, MSG_SIZ, "%6d     -  %s %s\n", e->games, elo, move);
+	strcat(p, buf);
+    }
+    free(found);
+    return p;
+}
+
 /* Load the nth game from open file f */
+static void
+RestoreAdjournedClocks (ChessMove result, char *details)
+{
+    if(result == GameUnfinished && details && appData.clockMode) {
+	long int w, b; // [HGM] adjourn: restore saved clock times
+	char *p = strstr(details, "(Clocks:");
+	if(p && sscanf(p+8, "%ld,%ld", &w, &b) == 2) {
+	    timeRemaining[0][forwardMostMove] = whiteTimeRemaining = 1000*w + 500;
+	    timeRemaining[1][forwardMostMove] = blackTimeRemaining = 1000*b + 500;
+	}
+    }
+}
+
 int
 LoadGame (FILE *f, int gameNumber, char *title, int useList)
 {
@@ -13181,14 +14532,7 @@ LoadGame (FILE *f, int gameNumber, char *title, int useList)
       AnalyzeFileEvent();
     }
 
-    if(gameInfo.result == GameUnfinished && gameInfo.resultDetails && appData.clockMode) {
-	long int w, b; // [HGM] adjourn: restore saved clock times
-	char *p = strstr(gameInfo.resultDetails, "(Clocks:");
-	if(p && sscanf(p+8, "%ld,%ld", &w, &b) == 2) {
-	    timeRemaining[0][forwardMostMove] = whiteTimeRemaining = 1000*w + 500;
-	    timeRemaining[1][forwardMostMove] = blackTimeRemaining = 1000*b + 500;
-	}
-    }
+    RestoreAdjournedClocks(gameInfo.result, gameInfo.resultDetails);
 
     if(creatingBook) return TRUE;
     if (!matchMode && pos > 0) {
@@ -13234,7 +14578,7 @@ LoadPositionFromFile (char *filename, int n, char *title)
     if (strcmp(filename, "-") == 0) {
 	return LoadPosition(stdin, n, "stdin");
     } else {
-	f = fopen(filename, "rb");
+	f = OpenPGNFile(filename, "rb");
 	if (f == NULL) {
             snprintf(buf, sizeof(buf), _("Can't open \"%s\""), filename);
 	    DisplayError(buf, errno);
@@ -13336,6 +14680,14 @@ LoadPosition (FILE *f, int positionNumber, char *title)
 	      blackPlaysFirst = TRUE;
 	}
     }
+    return StartFromPosition(initial_position, positionNumber, title);
+}
+
+static int
+StartFromPosition (Board initial_position, int positionNumber, char *title)
+{   // second half of LoadPosition, also used for positions from the opening cache
+    char line[MSG_SIZ];
+
     startedFromSetupPosition = TRUE;
 
     CopyBoard(boards[0], initial_position);
@@ -13377,6 +14729,287 @@ int i, j;
     return TRUE;
 }
 
+/* Opening cache: in a match every game takes its opening from the same game or position file.
+ * Rather than re-opening that file for each game, and skipping and parsing everything before
+ * the wanted game again, the file is parsed once when the match starts. For each game the
+ * variant, FEN and (legality-checked) moves are remembered, so that they can later be replayed
+ * without any parsing. Games from a setup diagram without FEN, or that failed to load, are not
+ * cached, and are left to LoadGameFromFile, which then reports the problem as it always did.
+ */
+typedef struct {
+    signed char fromX, fromY, toX, toY, killX, killY, promoChar;
+} OpeningMove;
+
+typedef struct {
+    VariantClass variant;
+    char *fen;            // FEN of the start position, or NULL for the normal one
+    OpeningMove *moves;
+    int nrMoves, maxMoves;
+    char **comments;      // per ply, NULL if the game has none
+    int nrComments;
+    ChessMove result;     // game end found in the file (or mate), if resultDetails != NULL
+    char *resultDetails;
+    char valid, noMoves;
+} Opening;
+
+static Opening *openings, *recording;
+static int nrOfOpenings, openingGames;
+static char *openingFile;
+static time_t openingTime;
+static off_t openingSize;
+
+static void
+RecordOpeningMove (int fromX, int fromY, int toX, int toY, int promoChar)
+{   // called by LoadGameOneMove for every move it makes while the cache is filled
+    OpeningMove *m;
+    if(!recording) return;
+    if(recording->nrMoves >= recording->maxMoves) {
+	recording->maxMoves = 2*recording->maxMoves + 16;
+	recording->moves = (OpeningMove *) realloc(recording->moves, recording->maxMoves * sizeof(OpeningMove));
+    }
+    m = &recording->moves[recording->nrMoves++];
+    m->fromX = fromX; m->fromY = fromY; m->toX = toX; m->toY = toY;
+    m->killX = killX; m->killY = killY; m->promoChar = promoChar;
+}
+
+static void
+FreeOpenings ()
+{
+    int i, j;
+    for(i=0; i<nrOfOpenings; i++) {
+	Opening *o = &openings[i];
+	FREE(o->fen); FREE(o->moves); FREE(o->resultDetails);
+	for(j=0; j<o->nrComments; j++) FREE(o->comments[j]);
+	FREE(o->comments);
+    }
+    FREE(openings); openings = NULL; nrOfOpenings = 0;
+    FREE(openingFile); openingFile = NULL;
+}
+
+static void
+SwapGameList (List *other)
+{   // exchange the games in gameList with those in another list
+    List tmp;
+    ListNode *node;
+
+    ListNew(&tmp);
+    while(!ListEmpty(&gameList)) node = gameList.head, ListRemove(node), ListAddTail(&tmp, node);
+    while(!ListEmpty(other)) node = other->head, ListRemove(node), ListAddTail(&gameList, node);
+    while(!ListEmpty(&tmp)) node = tmp.head, ListRemove(node), ListAddTail(other, node);
+}
+
+static int
+PreloadGames (FILE *f)
+{   // load all games with LoadGame, in the same way as for creating a book, and remember the result
+    // this needs a game list of the file, so the user's game list and its move cache are set aside meanwhile
+    ListGame *lg;
+    List userList;
+    Move *userMoves = moveDatabase, *copy = NULL;
+    unsigned int userPtr = movePtr, userSize = dataSize;
+    FILE *userFP = lastLoadGameFP, *userGameFP = gameFileFP;
+    int userNumber = lastLoadGameNumber, userUseList = lastLoadGameUseList;
+    char userTitle[MSG_SIZ];
+    int i, j, n = 0;
+
+    if(userMoves == initialSpace && userPtr) { // building the list below overwrites the static space
+	if((copy = (Move *) malloc(userPtr * sizeof(Move))) == NULL) return 0;
+	memcpy(copy, initialSpace, userPtr * sizeof(Move));
+    }
+    safeStrCpy(userTitle, lastLoadGameTitle, MSG_SIZ);
+    GameListDestroy(); // pops down the dialog of the user's list
+    ListNew(&userList);
+    SwapGameList(&userList);
+    moveDatabase = initialSpace; movePtr = 0; dataSize = DSIZE;
+    lastLoadGameFP = NULL; // keeps LoadGame from closing the user's game file
+
+    if(!GameListBuild(f) && !ListEmpty(&gameList)) {
+      n = ((ListGame *) gameList.tailPred)->number;
+      openings = (Opening *) calloc(n, sizeof(Opening));
+      creatingBook = TRUE; // suppresses engine initialization and auto-play
+      for(i=0, lg = (ListGame *) gameList.head; i<n; i++, lg = (ListGame *) lg->node.succ) {
+	Opening *o = recording = &openings[i];
+	Reset(FALSE, FALSE); // LoadGame would do it with engine initialization
+	if(!LoadGame(f, i+1, "", TRUE)) continue;
+	if(startedFromSetupPosition && !lg->gameInfo.fen) continue; // position diagram
+	if(o->nrMoves != forwardMostMove - backwardMostMove) continue; // should not happen
+	o->variant = gameInfo.variant;
+	if(lg->gameInfo.fen) o->fen = StrSave(lg->gameInfo.fen);
+	o->noMoves = (gameMode == EditGame);
+	if(gameInfo.resultDetails) o->result = gameInfo.result, o->resultDetails = StrSave(gameInfo.resultDetails);
+	for(j=0; j<=forwardMostMove; j++) if(commentList[j]) {
+	    if(!o->comments) o->comments = (char **) calloc(forwardMostMove + 1, sizeof(char *)), o->nrComments = forwardMostMove + 1;
+	    o->comments[j] = StrSave(commentList[j]);
+	}
+	o->valid = TRUE;
+      }
+      recording = NULL;
+      creatingBook = FALSE;
+    }
+
+    while(!ListEmpty(&gameList)) { // discard the list of the opening file
+	lg = (ListGame *) gameList.head;
+	ClearGameInfo(&lg->gameInfo);
+	ListNodeFree(&lg->node);
+    }
+    SwapGameList(&userList);
+    if(moveDatabase != initialSpace) free(moveDatabase);
+    if(copy) memcpy(initialSpace, copy, userPtr * sizeof(Move)), free(copy);
+    moveDatabase = userMoves; movePtr = userPtr; dataSize = userSize;
+    lastLoadGameFP = userFP; gameFileFP = userGameFP;
+    lastLoadGameNumber = userNumber; lastLoadGameUseList = userUseList;
+    safeStrCpy(lastLoadGameTitle, userTitle, MSG_SIZ);
+    return nrOfOpenings = n;
+}
+
+static int
+PreloadPositions (FILE *f)
+{   // every line of a FEN file is a position; old-style diagram files are left to LoadPosition
+    char line[MSG_SIZ];
+    Board board;
+    int btm, n = 0, max = 0;
+
+    if(fgets(line, MSG_SIZ, f) == NULL) return 0;
+    if(!(line[0] >= '0' && line[0] <= '9' || line[0] == '+' || line[0] == '*' || CharToPiece(line[0]) != EmptySquare)) return 0;
+    do {
+	if(n >= max) openings = (Opening *) realloc(openings, (max = 2*max + 256) * sizeof(Opening));
+	memset(&openings[n], 0, sizeof(Opening));
+	if(ParseFEN(board, &btm, line, FALSE)) openings[n].fen = StrSave(line), openings[n].valid = TRUE;
+	nrOfOpenings = ++n;
+    } while(fgets(line, MSG_SIZ, f));
+    return n;
+}
+
+static void
+PreloadOpenings ()
+{   // (re)fill the cache if the match uses another opening file than what is in it, or the file has changed
+    char *name = (*appData.loadGameFile ? appData.loadGameFile : appData.loadPositionFile);
+    int games = (*appData.loadGameFile != NULLCHAR);
+    struct stat st;
+    FILE *f;
+
+    if(!matchMode || *name == NULLCHAR || !strcmp(name, "-") || *engineVariant || stat(name, &st)) return;
+    if(openingFile && !strcmp(openingFile, name) && openingGames == games &&
+       st.st_mtime == openingTime && st.st_size == openingSize) return; // still valid
+    FreeOpenings();
+    if((f = OpenPGNFile(name, "rb")) == NULL) return;
+    if(!games) PreloadPositions(f); else PreloadGames(f);
+    fclose(f);
+    if(nrOfOpenings) {
+	openingFile = StrSave(name); openingGames = games;
+	openingTime = st.st_mtime; openingSize = st.st_size;
+    } else FreeOpenings();
+    if(appData.debugMode) fprintf(debugFP, "opening cache: %d %s from %s\n", nrOfOpenings, games ? "games" : "positions", name);
+}
+
+static int
+LoadCachedOpening (char *file, int n, int game)
+{   // set up the game from the opening cache, the way LoadGame or LoadPosition would have done it from the file
+    Opening *o;
+    Board initial_position;
+    char buf[MSG_SIZ];
+    int i;
+
+    if(!openingFile || strcmp(file, openingFile) || game != openingGames || n < 1 || n > nrOfOpenings) return FALSE;
+    o = &openings[n-1];
+    if(!o->valid) return FALSE;
+
+    if (gameMode == Training)
+	SetTrainingModeOff();
+    if (gameMode != BeginningOfGame) {
+	Reset(FALSE, TRUE);
+    }
+    if (!game) {
+	lastLoadPositionNumber = n;
+	if (first.pr == NoProc && !appData.noChessProgram) {
+	    StartChessProgram(&first);
+	    InitChessProgram(&first, FALSE);
+	}
+	ParseFEN(initial_position, &blackPlaysFirst, o->fen, TRUE); // re-expands shuffle FENs from the (seeded) random generator
+	return StartFromPosition(initial_position, n, file);
+    }
+
+    killX = killY = -1;
+    if (n > 1) {
+	snprintf(buf, MSG_SIZ, "%s %d", file, n);
+	DisplayTitle(buf);
+    } else DisplayTitle(file);
+    gameMode = PlayFromGameFile;
+    ModeHighlight();
+    currentMove = forwardMostMove = backwardMostMove = 0;
+    CopyBoard(boards[0], initialPosition);
+    StopClocks();
+
+    if (o->variant != gameInfo.variant) {
+	gameInfo.variant = o->variant;
+	startedFromPositionFile = FALSE;
+	ResetFrontEnd();
+	InitPosition(TRUE);
+    }
+    startedFromSetupPosition = FALSE;
+    if (o->fen) {
+	startedFromSetupPosition = TRUE;
+	ParseFEN(initial_position, &blackPlaysFirst, o->fen, TRUE);
+	CopyBoard(boards[0], initial_position);
+	if (blackPlaysFirst) {
+	    currentMove = forwardMostMove = backwardMostMove = 1;
+	    CopyBoard(boards[1], initial_position);
+	    moveList[0][0] = parseList[0][0] = NULLCHAR;
+	    timeRemaining[0][1] = whiteTimeRemaining;
+	    timeRemaining[1][1] = blackTimeRemaining;
+	}
+	initialRulePlies = FENrulePlies;
+	for (i = 0; i < nrCastlingRights; i++)
+	    initialRights[i] = initial_position[CASTLING][i];
+    }
+
+    if (first.pr == NoProc) {
+	StartChessProgram(&first);
+    }
+    InitChessProgram(&first, FALSE);
+    SendToProgram("force\n", &first);
+    if (startedFromSetupPosition) {
+	SendBoard(&first, forwardMostMove);
+	DisplayBothClocks();
+    }
+    loadFlag = appData.suppressLoadMoves;
+
+    if (o->noMoves) {
+	for (i = 0; i < o->nrComments; i++) if (o->comments[i]) commentList[i] = StrSave(o->comments[i]);
+	DisplayMessage("", _("No moves in game"));
+	DrawPosition(FALSE, boards[currentMove]);
+	DisplayBothClocks();
+	gameMode = EditGame;
+	ModeHighlight();
+	gameFileFP = NULL;
+	cmailOldMove = 0;
+	return TRUE;
+    }
+
+    for (i = 0; i < o->nrMoves; i++) { // replay, as LoadGameOneMove would
+	OpeningMove *m = &o->moves[i];
+	thinkOutput[0] = NULLCHAR;
+	killX = m->killX; killY = m->killY;
+	MakeMove(m->fromX, m->fromY, m->toX, m->toY, m->promoChar);
+	killX = killY = -1;
+	currentMove = forwardMostMove;
+	timeRemaining[0][forwardMostMove] = whiteTimeRemaining;
+	timeRemaining[1][forwardMostMove] = blackTimeRemaining;
+    }
+    for (i = 0; i < o->nrComments; i++) if (o->comments[i]) commentList[i] = StrSave(o->comments[i]);
+    if (o->resultDetails) GameEnds(o->result, o->resultDetails, GE_FILE);
+    DrawPosition(FALSE, boards[currentMove]);
+    DisplayBothClocks();
+    gameFileFP = NULL;
+    cmailOldMove = forwardMostMove;
+
+    currentMove = backwardMostMove;
+    HistorySet(parseList, backwardMostMove, forwardMostMove, currentMove-1);
+    RestoreAdjournedClocks(o->result, o->resultDetails);
+    ToEndEvent();
+    loadFlag = 0;
+    return TRUE;
+}
+
 
 void
 CopyPlayerNameIntoFileName (char **dest, char *src)
@@ -13411,16 +15044,56 @@ DefaultFileName (char *ext)
 }
 
 /* Save the current game to the given file */
+static int
+AppendGame (char *filename)
+{   // format the game in memory and append it with a single write; O_APPEND makes that atomic w.r.t. other instances
+#if HAVE_OPEN_MEMSTREAM
+    char *pgn = NULL;
+    size_t len = 0;
+    FILE *f;
+    int fd, n, err = 0;
+
+    if((f = open_memstream(&pgn, &len)) == NULL) return -1;
+    SaveGame(f, 0, NULL); // closes f, which finalizes pgn and len
+    if((fd = open(filename, O_WRONLY | O_APPEND | O_CREAT, 0666)) < 0) err = errno;
+    else {
+	if((n = write(fd, pgn, len)) != len) err = (n < 0 ? errno : EIO);
+	close(fd);
+    }
+    free(pgn);
+    return err;
+#else
+    return -1;
+#endif
+}
+
 int
 SaveGameToFile (char *filename, int append)
 {
     FILE *f;
-    char buf[MSG_SIZ];
+    char buf[MSG_SIZ], shard[MSG_SIZ];
     int result, i, t,tot=0;
 
     if (strcmp(filename, "-") == 0) {
 	return SaveGame(stdout, 0, NULL);
     } else {
+	if (append && appData.saveShards && matchMode) { // every instance writes its own file, to be merged later
+	    snprintf(shard, MSG_SIZ, "%s.%d", filename, (int) getpid());
+	    filename = shard;
+	}
+	if (append && strlen(filename) > 3 && !strcmp(filename + strlen(filename) - 3, ".gz")) {
+	    // compressed as a gzip member of its own, which is appended with a single write on closing
+	    if ((f = OpenPGNFile(filename, "a")) == NULL) {
+		snprintf(buf, sizeof(buf), _("Can't open \"%s\""), filename);
+		DisplayError(buf, errno);
+		return FALSE;
+	    }
+	    return SaveGame(f, 0, NULL);
+	}
+	if (append && appData.atomicSave && (result = AppendGame(filename)) >= 0) {
+	    if(result) DisplayError(_("Error writing save file"), result);
+	    return !result;
+	}
 	for(i=0; i<10; i++) { // upto 10 tries
 	     f = fopen(filename, append ? "a" : "w");
 	     if(f && i) fprintf(f, "[Delay \"%d retries, %d msec\"]\n",i,tot);
@@ -13551,7 +15224,12 @@ SaveGamePGN2 (FILE *f)
 
     PrintPGNTags(f, &gameInfo);
 
-    if(appData.numberTag && matchMode) fprintf(f, "[Number \"%d\"]\n", nextGame+1); // [HGM] number tag
+    if((appData.numberTag || appData.saveShards) && matchMode) fprintf(f, "[Number \"%d\"]\n", nextGame+1); // [HGM] number tag
+
+    if(appData.saveExtendedInfoInPGN) for(i=0; i<2; i++) if(lagStats[i].moves) // lag: GUI overhead on engine moves, in msec
+	fprintf(f, "[%sGUILag \"stop=%.3f/%.3f relay=%.3f/%.3f credit=%ld\"]\n", i ? "Black" : "White",
+		lagStats[i].stopSum/lagStats[i].moves/1000., lagStats[i].stopMax/1000.,
+		lagStats[i].relays ? lagStats[i].relaySum/lagStats[i].relays/1000. : 0., lagStats[i].relayMax/1000., lagStats[i].credited);
 
     if (backwardMostMove > 0 || startedFromSetupPosition) {
         char *fen = PositionToFEN(backwardMostMove, NULL, 1);
@@ -13638,11 +15316,14 @@ SaveGamePGN2 (FILE *f)
             /* [HGM] add time */
             char buf[MSG_SIZ]; int seconds;
 
-            seconds = (pvInfoList[i].time+5)/10; // deci-seconds, rounded to nearest
+            seconds = (pvInfoList[i].time+50)/100; // deci-seconds, rounded to nearest
 
-            if( seconds <= 0)
+            if( pvInfoList[i].time <= 0)
 	      buf[0] = 0;
 	    else
+	      if( pvInfoList[i].time < 1000 ) // sub-second moves (bullet) with msec precision
+		snprintf(buf, MSG_SIZ, " %5.3f%c", pvInfoList[i].time/1000., 0);
+	      else
 	      if( seconds < 30 )
 		snprintf(buf, MSG_SIZ, " %3.1f%c", seconds/10., 0);
 	      else
@@ -14205,6 +15886,8 @@ ExitEvent (int status)
         if(appData.debugMode && endingGame) fprintf(debugFP, "GameEnds() seems stuck, proceed exiting\n");
     }
 
+    AnnotateStop(NULL); // batch annotators, if any
+
     /* Kill off chess programs */
     if (first.pr != NoProc) {
 	ExitAnalyzeMode();
@@ -14366,7 +16049,7 @@ void
 EditTagsEvent ()
 {
     char *tags = PGNTags(&gameInfo);
-    bookUp = FALSE;
+    bookUp = explorerUp = FALSE;
     EditTagsPopUp(tags, NULL);
     free(tags);
 }
@@ -14467,6 +16150,11 @@ AnalyzeFileEvent ()
     if (appData.noChessProgram || gameMode == AnalyzeFile)
       return;
 
+    if (*appData.annotateFile && GameFile()) { // batch mode: annotate the whole game list
+	AnnotateFileEvent();
+	return;
+    }
+
     if (!first.analysisSupport) {
       char buf[MSG_SIZ];
       snprintf(buf, sizeof(buf), _("%s does not support analysis"), first.tidy);
@@ -14658,7 +16346,7 @@ MachineBlackEvent ()
 void
 DisplayTwoMachinesTitle ()
 {
-    char buf[MSG_SIZ];
+    char buf[2*MSG_SIZ], stats[MSG_SIZ]; // names and score take at most MSG_SIZ, the stats another
     if (appData.matchGames > 0) {
         if(appData.tourneyFile[0]) {
 	  snprintf(buf, MSG_SIZ, "%s %s %s (%d/%d%s)",
@@ -14677,6 +16365,8 @@ DisplayTwoMachinesTitle ()
 		   second.matchWins, first.matchWins,
 		   matchGame - 1 - (first.matchWins + second.matchWins));
 	}
+	if(!appData.tourneyFile[0] && *MatchStatsText(stats, MSG_SIZ)) // Elo, LOS and SPRT status
+	  snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), " %s", stats);
     } else {
       snprintf(buf, MSG_SIZ, "%s %s %s", gameInfo.white, _("vs."), gameInfo.black);
     }
@@ -15699,6 +17389,7 @@ ForwardInner (int target)
 	DisplayComment(currentMove - 1, commentList[currentMove]);
     }
     ClearMap(); // [HGM] exclude: invalidate map
+    ShowCachedAnalysis();
 }
 
 
@@ -15818,6 +17509,7 @@ BackwardInner (int target)
     // [HGM] PV info: routine tests if comment empty
     DisplayComment(currentMove - 1, commentList[currentMove]);
     ClearMap(); // [HGM] exclude: invalidate map
+    ShowCachedAnalysis();
 }
 
 void
@@ -16082,6 +17774,369 @@ CreateBookEvent ()
     FlushBook();
 }
 
+/* Batch annotation: the positions of all (selected) games in the game list
+ * are searched by a pool of engine processes with a fixed budget per
+ * position, and the annotated games are written to appData.annotateFile
+ * in their original order.  Only a small window of games is kept in memory;
+ * a game is loaded once to queue its positions, and again when all its
+ * positions have been searched, to add the results and save it.
+ */
+#define MAX_ANNOTATORS 64
+
+typedef struct {
+    int game, move;		/* game number in list, position analyzed */
+    int state;			/* 0 = waiting, 1 = being searched, 2 = done */
+    int depth, score;
+    u64 key;			/* for the analysis cache */
+    VariantClass variant;
+    char *fen, *pv;
+} AnnotateJob;
+
+typedef struct {
+    ProcRef pr;
+    InputSourceRef isr;
+    int ready, memory, smp;
+    int job;			/* index in job list, or -1 when idle */
+    int depth, score, time;
+    u64 nodes;
+    char pv[MSG_SIZ];
+} Annotator;
+
+static struct {
+    FILE *in, *out;
+    int nGames, nextLoad, written, nEngines, alive, frozen;
+    AnnotateJob *job;
+    int nJobs, maxJobs;
+    Annotator eng[MAX_ANNOTATORS];
+} annotate;
+
+static void AnnotateDispatch P((void));
+
+static int
+AnnotateFileOK ()
+{   // the games are read from the open game list, with LoadGame, so that must still be the one we started on
+    return annotate.in && GameFile() == annotate.in && lastLoadGameFP == annotate.in;
+}
+
+static void
+AnnotateSend (Annotator *e, char *message)
+{
+    int err;
+    if (appData.debugMode) {
+	TimeMark now;
+	GetTimeMark(&now);
+	fprintf(debugFP, "%ld >annot%d: %s", SubtractTimeMarks(&now, &programStartTime), (int)(e - annotate.eng), message);
+    }
+    if (OutputToProcess(e->pr, message, strlen(message), &err) < 0 && appData.debugMode)
+	fprintf(debugFP, "annotator write error %d\n", err);
+}
+
+static void
+AnnotateStop (char *message)
+{
+    int i;
+    for (i = 0; i < annotate.nEngines; i++) {
+	Annotator *e = &annotate.eng[i];
+	if (e->isr) RemoveInputSource(e->isr), e->isr = NULL;
+	if (e->pr != NoProc) {
+	    AnnotateSend(e, "quit\n");
+	    DestroyChildProcess(e->pr, 4 + first.useSigterm);
+	    e->pr = NoProc;
+	}
+    }
+    for (i = 0; i < annotate.nJobs; i++) {
+	FREE(annotate.job[i].fen);
+	FREE(annotate.job[i].pv);
+    }
+    FREE(annotate.job);
+    annotate.job = NULL; annotate.nJobs = annotate.maxJobs = annotate.nEngines = 0;
+    if (annotate.out) fclose(annotate.out);
+    annotate.out = NULL; annotate.in = NULL;
+    if (annotate.frozen) AnnotatePopDown(), annotate.frozen = FALSE;
+    DisplayMessage("", "");
+    if (message) DisplayNote(message);
+}
+
+static AnnotateJob *
+AnnotateNewJob (int game, int move)
+{
+    AnnotateJob *j;
+    if (annotate.nJobs >= annotate.maxJobs) {
+	annotate.maxJobs = 2*annotate.maxJobs + 64;
+	annotate.job = (AnnotateJob *) realloc(annotate.job, annotate.maxJobs * sizeof(AnnotateJob));
+    }
+    j = &annotate.job[annotate.nJobs++];
+    j->game = game; j->move = move; j->state = 2;
+    j->depth = 0; j->fen = j->pv = NULL;
+    j->variant = gameInfo.variant;
+    return j;
+}
+
+static void
+AnnotateQueueGame (int n)
+{   // load game and queue all its positions; a game without any still gets an entry, to be written in turn
+    int i, r, mate;
+    CacheEntry c;
+    creatingBook = TRUE;
+    r = LoadGame(annotate.in, n, "", TRUE);
+    creatingBook = FALSE;
+    if (!r) { AnnotateNewJob(n, -1); return; }
+    for (i = backwardMostMove + 1; i <= forwardMostMove; i++) {
+	AnnotateJob *j = AnnotateNewJob(n, i);
+	mate = MateTest(boards[i], PosFlags(i));
+	if (mate != MT_NONE && mate != MT_CHECK) continue; // no moves left: nothing for the engine to search
+	j->key = AnalysisKey(i);
+	if (ProbeCache(j->key, &c) && c.depth >= (appData.annotateDepth > 0 ? appData.annotateDepth : appData.analysisCacheDepth)) {
+	    j->depth = c.depth; j->score = c.score; j->pv = StrSave(c.pv);
+	    continue; // known from earlier analysis
+	}
+	j->fen = PositionToFEN(i, NULL, 1);
+	j->state = 0;
+    }
+    if (backwardMostMove >= forwardMostMove) AnnotateNewJob(n, -1);
+}
+
+static void
+AnnotateWriteGames ()
+{   // save every game at the head of the queue of which all positions are done
+    while (annotate.nJobs) {
+	int i, r, n = 0, g = annotate.job[0].game;
+	char buf[MSG_SIZ];
+	while (n < annotate.nJobs && annotate.job[n].game == g) if (annotate.job[n++].state != 2) return;
+	if (!AnnotateFileOK()) { AnnotateStop(_("Game list closed; annotation aborted")); return; }
+	creatingBook = TRUE;
+	r = LoadGame(annotate.in, g, "", TRUE);
+	if (r && appData.pvSAN[0]) { // convert the PVs as for the thinking output; that overwrites the game behind them,
+	    int last = forwardMostMove, end = endPV; // so go from the last position back, and load the game again afterwards
+	    for (i = n - 1; i >= 0; i--) {
+		AnnotateJob *j = &annotate.job[i];
+		char *san;
+		if (j->move < 0 || j->move >= last || !j->pv || !*j->pv) continue;
+		forwardMostMove = endPV = j->move;
+		san = StrSave(PvToSAN(j->pv));
+		FREE(j->pv); j->pv = san;
+	    }
+	    endPV = end;
+	    r = LoadGame(annotate.in, g, "", TRUE);
+	}
+	if (r) {
+	    for (i = 0; i < n; i++) {
+		AnnotateJob *j = &annotate.job[i];
+		if (j->move < 0 || j->move > forwardMostMove || j->depth <= 0) continue;
+		pvInfoList[j->move].depth = j->depth;
+		pvInfoList[j->move].score = j->score;
+		pvInfoList[j->move].time  = 0;
+		if (j->move < forwardMostMove) {
+		    if (j->pv && *j->pv) AppendComment(j->move + 1, j->pv, 2);
+		} else { // analysis of final position as comment
+		    snprintf(buf, MSG_SIZ, "{final score %+4.2f/%d}", j->score/100., j->depth);
+		    AppendComment(j->move, buf, 3);
+		}
+	    }
+	    SaveGamePGN2(annotate.out);
+	    fflush(annotate.out);
+	}
+	creatingBook = FALSE;
+	for (i = 0; i < n; i++) { FREE(annotate.job[i].fen); FREE(annotate.job[i].pv); }
+	annotate.nJobs -= n;
+	memmove(annotate.job, annotate.job + n, annotate.nJobs * sizeof(AnnotateJob));
+	for (i = 0; i < annotate.nEngines; i++) if (annotate.eng[i].job >= 0) annotate.eng[i].job -= n;
+	snprintf(buf, MSG_SIZ, _("Annotated %d of %d games"), ++annotate.written, annotate.nGames);
+	DisplayMessage("", buf);
+    }
+}
+
+static void
+AnnotateReceive (InputSourceRef isr, VOIDSTAR closure, char *message, int count, int error)
+{
+    Annotator *e = (Annotator *) closure;
+    int plylev, curscore, time;
+    char plyext, *p;
+    u64 nodes;
+
+    if (isr != e->isr) return;
+    if (annotate.frozen && !AnnotateDialogUp()) { // the user closed the dialog
+	AnnotateAbortEvent();
+	return;
+    }
+    if (count <= 0) { // engine died; give its position to another one
+	RemoveInputSource(e->isr); e->isr = NULL;
+	DestroyChildProcess(e->pr, 9); e->pr = NoProc;
+	if (e->job >= 0) annotate.job[e->job].state = 0;
+	e->job = -1; e->ready = FALSE;
+	if (--annotate.alive == 0) { AnnotateStop(_("Annotation engines exited unexpectedly")); return; }
+	AnnotateDispatch();
+	return;
+    }
+    if ((p = strchr(message, '\r')) != NULL) *p = NULLCHAR;
+    if ((p = strchr(message, '\n')) != NULL) *p = NULLCHAR;
+    if (appData.debugMode) {
+	TimeMark now;
+	GetTimeMark(&now);
+	fprintf(debugFP, "%ld <annot%d: %s\n", SubtractTimeMarks(&now, &programStartTime), (int)(e - annotate.eng), message);
+    }
+
+    if (!e->ready) {
+	if (!strncmp(message, "feature ", 8)) {
+	    if (strstr(message, "memory=1")) e->memory = TRUE;
+	    if (strstr(message, "smp=1")) e->smp = TRUE;
+	    if (!strstr(message, "done=1")) return;
+	} else if (strncmp(message, "pong", 4)) return;
+	e->ready = TRUE;
+	if (e->memory && appData.defaultHashSize > 0) {
+	    char buf[MSG_SIZ];
+	    snprintf(buf, MSG_SIZ, "memory %d\n", appData.defaultHashSize);
+	    AnnotateSend(e, buf);
+	}
+	if (e->smp) AnnotateSend(e, "cores 1\n");
+	AnnotateDispatch();
+	return;
+    }
+    if (e->job < 0) return;
+
+    if (sscanf(message, "%d%c %d %d " u64Display, &plylev, &plyext, &curscore, &time, &nodes) == 5 && plylev > 0) {
+	int k;
+	for (p = message, k = 0; k < 5 && *p; k++) { // skip to PV after the fifth field
+	    while (*p == ' ' || *p == '\t') p++;
+	    while (*p && *p != ' ' && *p != '\t') p++;
+	}
+	while (*p == ' ' || *p == '\t') p++;
+	if (plyext != ' ' && plyext != '\t') time *= 100;
+	if (first.scoreIsAbsolute && !WhiteOnMove(annotate.job[e->job].move)) curscore = -curscore;
+	e->depth = plylev; e->score = curscore; e->time = time; e->nodes = nodes;
+	safeStrCpy(e->pv, p, MSG_SIZ);
+	return;
+    }
+    if (!strncmp(message, "move ", 5) || !strncmp(message, "resign", 6) ||
+	!strncmp(message, "1-0", 3) || !strncmp(message, "0-1", 3) || !strncmp(message, "1/2-1/2", 7)) {
+	AnnotateJob *j = &annotate.job[e->job];
+	j->depth = e->depth; j->score = e->score; j->pv = StrSave(e->pv);
+	j->state = 2; e->job = -1;
+	StoreCache(j->key, e->depth, e->score, e->time, e->nodes, e->pv);
+	AnnotateWriteGames();
+	if (annotate.nEngines) AnnotateDispatch();
+    }
+}
+
+static void
+AnnotateDispatch ()
+{
+    int i, k, waiting;
+    char buf[MSG_SIZ + 16]; // room for a command before an argument of up to MSG_SIZ
+
+    if (!annotate.nEngines) return;
+    if (!AnnotateFileOK()) { AnnotateStop(_("Game list closed; annotation aborted")); return; }
+    for (k = waiting = 0; k < annotate.nJobs; k++) waiting += (annotate.job[k].state == 0);
+    while (waiting < 2*annotate.alive && annotate.nextLoad <= annotate.nGames) {
+	ListGame *lg = (ListGame *) ListElem(&gameList, annotate.nextLoad - 1);
+	k = annotate.nJobs;
+	if (lg && lg->position >= 0) AnnotateQueueGame(annotate.nextLoad);
+	annotate.nextLoad++;
+	for (; k < annotate.nJobs; k++) waiting += (annotate.job[k].state == 0);
+    }
+    AnnotateWriteGames(); // games without anything to search
+    if (!annotate.nEngines) return;
+    if (!annotate.nJobs && annotate.nextLoad > annotate.nGames) {
+	snprintf(buf, sizeof(buf), _("%d annotated games saved to %s"), annotate.written, appData.annotateFile);
+	AnnotateStop(buf);
+	return;
+    }
+
+    for (i = k = 0; i < annotate.nEngines; i++) {
+	Annotator *e = &annotate.eng[i];
+	AnnotateJob *j;
+	if (!e->ready || e->job >= 0 || e->pr == NoProc) continue;
+	while (k < annotate.nJobs && annotate.job[k].state != 0) k++;
+	if (k >= annotate.nJobs) break;
+	j = &annotate.job[k]; j->state = 1;
+	e->job = k; e->depth = 0; e->pv[0] = NULLCHAR;
+	AnnotateSend(e, "new\neasy\nforce\n");
+	if (j->variant != VariantNormal) {
+	    snprintf(buf, sizeof(buf), "variant %s\n", VariantName(j->variant));
+	    AnnotateSend(e, buf);
+	}
+	snprintf(buf, sizeof(buf), "setboard %s\n", j->fen);
+	AnnotateSend(e, buf);
+	if (appData.annotateDepth > 0) {
+	    snprintf(buf, sizeof(buf), "sd %d\n", appData.annotateDepth);
+	    AnnotateSend(e, buf);
+	}
+	if (appData.annotateNodes > 0) { // node budget as one second at the given speed
+	    snprintf(buf, sizeof(buf), "nps %d\nst 1\n", appData.annotateNodes);
+	} else snprintf(buf, sizeof(buf), "st %d\n", appData.annotateTime > 0 ? appData.annotateTime :
+							    appData.annotateDepth > 0 ? 3600 : 1);
+	AnnotateSend(e, buf);
+	AnnotateSend(e, "post\ngo\n");
+    }
+}
+
+void
+AnnotateAbortEvent ()
+{
+    if (annotate.nEngines) AnnotateStop(_("Annotation aborted"));
+}
+
+void
+AnnotateFileEvent ()
+{
+    int i, n, err = 0;
+    char buf[MSG_SIZ];
+
+    if (annotate.nEngines) {
+	DisplayError(_("Batch annotation already in progress"), 0);
+	return;
+    }
+    if (appData.icsActive || matchMode) {
+	DisplayError(_("Batch annotation is not possible now"), 0);
+	return;
+    }
+    if (!(annotate.in = GameFile()) || ((ListGame *) gameList.tailPred)->number <= 0 || !AnnotateFileOK()) {
+	annotate.in = NULL;
+	DisplayError(_("Game list not loaded or empty"), 0);
+	return;
+    }
+    if (strcmp(first.host, "localhost")) {
+	DisplayError(_("Batch annotation requires a local engine"), 0);
+	return;
+    }
+    // the games are loaded on the board, so annotation is modal: stop everything else, and lock out the user
+    EditGameEvent();
+    if (gameMode != EditGame) return;
+    if (!(annotate.out = fopen(appData.annotateFile, "a"))) {
+	snprintf(buf, MSG_SIZ, _("Can't open \"%s\""), appData.annotateFile);
+	DisplayError(buf, errno);
+	return;
+    }
+
+    n = appData.annotateEngines;
+    if (n < 1) n = 1;
+    if (n > MAX_ANNOTATORS) n = MAX_ANNOTATORS;
+    annotate.alive = 0;
+    for (i = 0; i < n; i++) {
+	Annotator *e = &annotate.eng[i];
+	e->ready = e->memory = e->smp = FALSE; e->job = -1; e->isr = NULL;
+	if ((err = StartChildProcess(first.program, first.dir, &e->pr)) != 0) {
+	    e->pr = NoProc;
+	    continue;
+	}
+	e->isr = AddInputSource(e->pr, TRUE, AnnotateReceive, (VOIDSTAR) e);
+	annotate.alive++;
+	AnnotateSend(e, "xboard\nprotover 2\nping 1\n");
+    }
+    annotate.nEngines = n;
+    if (!annotate.alive) {
+	snprintf(buf, MSG_SIZ, _("Startup failure on '%s'"), first.program);
+	AnnotateStop(NULL);
+	DisplayError(buf, err);
+	return;
+    }
+    annotate.nGames = ((ListGame *) gameList.tailPred)->number;
+    annotate.nextLoad = 1; annotate.written = 0;
+    AnnotatePopUp(); annotate.frozen = TRUE; // modal until AnnotateStop()
+    DisplayMessage("", _("Annotating game list..."));
+    AnnotateDispatch(); // queue first games; engines pick them up when they report ready
+}
+
 void
 BookEvent ()
 {
@@ -16425,7 +18480,7 @@ GetInfoFromComment (int index, char * text)
     if( text != NULL && index > 0 ) {
         int score = 0;
         int depth = 0;
-        int time = -1, sec = 0, deci;
+        int time = -1, sec = 0, deci, digits, fraction;
         char * s_eval = FindStr( text, "[%eval " );
         char * s_emt = FindStr( text, "[%emt " );
 #if 0
@@ -16471,9 +18526,9 @@ GetInfoFromComment (int index, char * text)
                *p = '\n'; while(*p == ' ' || *p == '\n') p++; *--p = '{';
                // we now moved the brace to behind the PV: "(.*) {+0.23/6 ..."
             }
-            time = -1; sec = -1; deci = -1;
+            time = -1; sec = -1; deci = -1; digits = 1;
             if( sscanf( p+1, "%d.%d/%d %d:%d", &score, &score_lo, &depth, &time, &sec ) != 5 &&
-		sscanf( p+1, "%d.%d/%d %d.%d", &score, &score_lo, &depth, &time, &deci ) != 5 &&
+		sscanf( p+1, "%d.%d/%d %d.%n%d%n", &score, &score_lo, &depth, &time, &digits, &deci, &fraction ) != 5 &&
                 sscanf( p+1, "%d.%d/%d %d", &score, &score_lo, &depth, &time ) != 4 &&
                 sscanf( p+1, "%d.%d/%d", &score, &score_lo, &depth ) != 3   ) {
                 return text;
@@ -16483,8 +18538,12 @@ GetInfoFromComment (int index, char * text)
                 return text;
             }
 
-            if(sec >= 0) time = 600*time + 10*sec; else
-            if(deci >= 0) time = 10*time + deci; else time *= 10; // deci-sec
+            if(deci >= 0) { // fractional seconds: scale to msec according to number of digits
+                for(digits = fraction - digits; digits < 3; digits++) deci *= 10;
+                for( ; digits > 3; digits--) deci /= 10;
+            }
+            if(sec >= 0) time = 60000*time + 1000*sec; else
+            if(deci >= 0) time = 1000*time + deci; else time *= 1000; // msec
 
             score = score > 0 || !score & p[1] != '-' ? score*100 + score_lo : score*100 - score_lo;
 
@@ -16509,7 +18568,7 @@ GetInfoFromComment (int index, char * text)
 
         pvInfoList[index-1].depth = depth;
         pvInfoList[index-1].score = score;
-        pvInfoList[index-1].time  = 10*time; // centi-sec
+        pvInfoList[index-1].time  = time; // msec
         if(*sep == '}') *sep = 0; else *--sep = '{';
         if(p != text) { while(*p++ = *sep++); sep = text; } // squeeze out space between PV and comment, and return both
     }
@@ -16560,6 +18619,32 @@ SendToProgram (char *message, ChessProgramState *cps)
     }
 }
 
+static char *protocolCommands[] = { // a space stands for optional white space
+    "move ", "offer", "resign", "feature ", "error ", "illegal ", "tell", "0-1 ", "1-0 ", "1/2-1/2 ",
+    "setboard ", "setup ", "hint: ", "pong ", NULL
+};
+
+static int
+ProtocolLine (char *message)
+{   // recognize engine output the protocol defines: thinking output or a command followed by something
+    char *p = message, *q, **cmd;
+    int i;
+
+    for(i=0; i<4; i++) { // four numbers, after the first of which an arbitrary character
+	strtol(p, &q, 10);
+	if(q == p || i == 0 && !*q++) break;
+	p = q;
+    }
+    if(i == 4) return TRUE;
+
+    for(cmd = protocolCommands; *cmd; cmd++) {
+	for(p = message, q = *cmd; *q && *q != ' ' && *p == *q; p++, q++);
+	if(*q == ' ') while(isspace(*p)) p++; else if(*q) continue;
+	if(*p) return TRUE;
+    }
+    return FALSE;
+}
+
 void
 ReceiveFromProgram (InputSourceRef isr, VOIDSTAR closure, char *message, int count, int error)
 {
@@ -16568,6 +18653,7 @@ ReceiveFromProgram (InputSourceRef isr, VOIDSTAR closure, char *message, int cou
     ChessProgramState *cps = (ChessProgramState *)closure;
 
     if (isr != cps->isr) return; /* Killed intentionally */
+    GetTimeMark(&lineReadTM); // lag: the clock of the engine should ideally stop now
     if (count <= 0) {
 	if (count == 0) {
 	    RemoveInputSource(cps->isr);
@@ -16610,35 +18696,26 @@ ReceiveFromProgram (InputSourceRef isr, VOIDSTAR closure, char *message, int cou
       *end_str = NULLCHAR;
 
     if (appData.debugMode) {
-	TimeMark now; int print = 1;
-	char *quote = ""; char c; int i;
+	int print = 1;
+	char *quote = "";
 
 	if(appData.engineComments != 1) { /* [HGM] debug: decide if protocol-violating output is written */
 		char start = message[0];
 		if(start >='A' && start <= 'Z') start += 'a' - 'A'; // be tolerant to capitalizing
-		if(sscanf(message, "%d%c%d%d%d", &i, &c, &i, &i, &i) != 5 &&
-		   sscanf(message, "move %c", &c)!=1  && sscanf(message, "offer%c", &c)!=1 &&
-		   sscanf(message, "resign%c", &c)!=1 && sscanf(message, "feature %c", &c)!=1 &&
-		   sscanf(message, "error %c", &c)!=1 && sscanf(message, "illegal %c", &c)!=1 &&
-		   sscanf(message, "tell%c", &c)!=1   && sscanf(message, "0-1 %c", &c)!=1 &&
-		   sscanf(message, "1-0 %c", &c)!=1   && sscanf(message, "1/2-1/2 %c", &c)!=1 &&
-		   sscanf(message, "setboard %c", &c)!=1   && sscanf(message, "setup %c", &c)!=1 &&
-		   sscanf(message, "hint: %c", &c)!=1 &&
-		   sscanf(message, "pong %c", &c)!=1   && start != '#')	{
+		if(start != '#' && !ProtocolLine(message)) {
 		    quote = appData.engineComments == 2 ? "# " : "### NON-COMPLIANT! ### ";
 		    print = (appData.engineComments >= 2);
 		}
 		message[0] = start; // restore original message
 	}
-	if(print) {
-		GetTimeMark(&now);
+	if(print) { // time stamp is when the line was read
 		fprintf(debugFP, "%ld <%-6s: %s%s\n",
-			SubtractTimeMarks(&now, &programStartTime), cps->which,
+			SubtractTimeMarks(&lineReadTM, &programStartTime), cps->which,
 			quote,
 			message);
 		if(serverFP)
 		    fprintf(serverFP, "%ld <%-6s: %s%s\n",
-			SubtractTimeMarks(&now, &programStartTime), cps->which,
+			SubtractTimeMarks(&lineReadTM, &programStartTime), cps->which,
 			quote,
 			message), fflush(serverFP);
 	}
@@ -16651,7 +18728,9 @@ ReceiveFromProgram (InputSourceRef isr, VOIDSTAR closure, char *message, int cou
             strstr(message, "tellics") != NULL) return;
     }
 
+    lineReader = cps;
     HandleMachineMove(message, cps);
+    lineReader = NULL;
 }
 
 
@@ -16986,6 +19065,7 @@ ParseFeatures (char *args, ChessProgramState *cps)
     if (BoolFeature(&p, "colors", &cps->useColors, cps)) continue;
     if (BoolFeature(&p, "usermove", &cps->useUsermove, cps)) continue;
     if (BoolFeature(&p, "exclude", &cps->excludeMoves, cps)) continue;
+    if (cps == &pairing && BoolFeature(&p, "pairing-result", &cps->resultDeltas, cps)) continue;
     if (BoolFeature(&p, "ics", &cps->sendICS, cps)) continue;
     if (BoolFeature(&p, "name", &cps->sendName, cps)) continue;
     if (BoolFeature(&p, "pause", &cps->pause, cps)) continue; // [HGM] pause
@@ -17389,10 +19469,24 @@ DisplayBothClocks ()
 #include <sys/timeb.h>
 #endif
 
-/* Get the current time as a TimeMark */
+/* Get the current time as a TimeMark.
+   Prefer a monotonic clock, so that the time of day being set
+   (e.g. by NTP) does not make the game clocks jump.
+*/
 void
 GetTimeMark (TimeMark *tm)
 {
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_MONOTONIC)
+
+    struct timespec timeSpec;
+
+    if(clock_gettime(CLOCK_MONOTONIC, &timeSpec) == 0) {
+	tm->sec = (long) timeSpec.tv_sec;
+	tm->ms = (int) (timeSpec.tv_nsec / 1000000L);
+	tm->us = (int) (timeSpec.tv_nsec / 1000L % 1000L);
+	return;
+    }
+#endif
 #if HAVE_GETTIMEOFDAY
 
     struct timeval timeVal;
@@ -17401,6 +19495,7 @@ GetTimeMark (TimeMark *tm)
     gettimeofday(&timeVal, &timeZone);
     tm->sec = (long) timeVal.tv_sec;
     tm->ms = (int) (timeVal.tv_usec / 1000L);
+    tm->us = (int) (timeVal.tv_usec % 1000L);
 
 #else /*!HAVE_GETTIMEOFDAY*/
 #if HAVE_FTIME
@@ -17411,16 +19506,20 @@ GetTimeMark (TimeMark *tm)
     ftime(&timeB);
     tm->sec = (long) timeB.time;
     tm->ms = (int) timeB.millitm;
+    tm->us = 0;
 
 #else /*!HAVE_FTIME && !HAVE_GETTIMEOFDAY*/
     tm->sec = (long) time(NULL);
     tm->ms = 0;
+    tm->us = 0;
 #endif
 #endif
 }
 
 /* Return the difference in milliseconds between two
    time marks.  We assume the difference will fit in a long!
+   The sub-millisecond part is deliberately ignored, so that the
+   lengths of consecutive intervals add up exactly.
 */
 long
 SubtractTimeMarks (TimeMark *tm2, TimeMark *tm1)
@@ -17429,6 +19528,13 @@ SubtractTimeMarks (TimeMark *tm2, TimeMark *tm1)
            (long) (tm2->ms - tm1->ms);
 }
 
+/* Return the difference in microseconds between two time marks */
+double
+SubtractTimeMarksMicro (TimeMark *tm2, TimeMark *tm1)
+{
+    return 1e6*(tm2->sec - tm1->sec) + 1000.*(tm2->ms - tm1->ms) + (tm2->us - tm1->us);
+}
+
 
 /*
  * Code to manage the game clocks.
@@ -17595,22 +19701,34 @@ SwitchClocks (int newMoveNr)
 
     GetTimeMark(&now);
 
+    if(lagMover) { // lag: move comes from engine; account for time it took us to get here
+	LagStats *l = &lagStats[!WhiteOnMove(forwardMostMove)];
+	double lag = SubtractTimeMarksMicro(&now, &lineReadTM);
+	l->moves++; l->stopSum += lag;
+	if(lag > l->stopMax) l->stopMax = lag;
+    }
+
     if (StopClockTimer() && appData.clockMode) {
 	lastTickLength = SubtractTimeMarks(&now, &tickStartTM);
+	if(lagMover && appData.creditGuiLag) { // lag: do not charge the engine for our overhead
+	    long credit = SubtractTimeMarks(&now, &lineReadTM);
+	    if(credit > lastTickLength) credit = lastTickLength; // we cannot give back more than the last tick took
+	    if(credit > 0) lastTickLength -= credit, lagStats[!WhiteOnMove(forwardMostMove)].credited += credit;
+	}
 	if (!WhiteOnMove(forwardMostMove)) {
 	    if(blackNPS >= 0) lastTickLength = 0;
 	    blackTimeRemaining -= lastTickLength;
            /* [HGM] PGNtime: save time for PGN file if engine did not give it */
 //         if(pvInfoList[forwardMostMove].time == -1)
-                 pvInfoList[forwardMostMove].time =               // use GUI time
-                      (timeRemaining[1][forwardMostMove-1] - blackTimeRemaining)/10;
+                 pvInfoList[forwardMostMove].time =               // use GUI time (msec)
+                      timeRemaining[1][forwardMostMove-1] - blackTimeRemaining;
 	} else {
 	   if(whiteNPS >= 0) lastTickLength = 0;
 	   whiteTimeRemaining -= lastTickLength;
            /* [HGM] PGNtime: save time for PGN file if engine did not give it */
 //         if(pvInfoList[forwardMostMove].time == -1)
                  pvInfoList[forwardMostMove].time =
-                      (timeRemaining[0][forwardMostMove-1] - whiteTimeRemaining)/10;
+                      timeRemaining[0][forwardMostMove-1] - whiteTimeRemaining;
 	}
 	flagged = CheckFlags();
     }
@@ -18514,14 +20632,57 @@ wrap (char *dest, char *src, int count, int width, int *lp)
     return len;
 }
 
+static int
+GrowGameStorage (int needed)
+{   // make sure the game record has room for moves up to 'needed' (plus the shelved variations);
+    // the latter are kept at the top of the arrays, so these are moved up when we enlarge them
+    int i, j, size = maxMoves, shift, stack = maxMoves - (framePtr + 1);
+    void *p[7];
+
+    if(needed + stack < maxMoves) return TRUE;
+    while(size <= needed + stack + 1) size = (size ? 2*size : MAX_MOVES);
+    p[0] = realloc(boards, size * sizeof(Board));          if(p[0]) boards = p[0];
+    p[1] = realloc(moveList, size * sizeof(*moveList));    if(p[1]) moveList = p[1];
+    p[2] = realloc(parseList, size * sizeof(*parseList));  if(p[2]) parseList = p[2];
+    p[3] = realloc(commentList, size * sizeof(char *));    if(p[3]) commentList = p[3];
+    p[4] = realloc(pvInfoList, size * sizeof(ChessProgramStats_Move)); if(p[4]) pvInfoList = p[4];
+    p[5] = realloc(timeRemaining[0], size * sizeof(long)); if(p[5]) timeRemaining[0] = p[5];
+    p[6] = realloc(timeRemaining[1], size * sizeof(long)); if(p[6]) timeRemaining[1] = p[6];
+    for(i=0; i<7; i++) if(!p[i]) return FALSE; // arrays that did grow will do so again next time
+    shift = size - maxMoves;
+    if(stack) { // move the variation stack to the new top
+	j = framePtr + 1;
+	memmove(boards + j + shift, boards + j, stack * sizeof(Board));
+	memmove(moveList + j + shift, moveList + j, stack * sizeof(*moveList));
+	memmove(parseList + j + shift, parseList + j, stack * sizeof(*parseList));
+	memmove(commentList + j + shift, commentList + j, stack * sizeof(char *));
+	memmove(pvInfoList + j + shift, pvInfoList + j, stack * sizeof(ChessProgramStats_Move));
+	memmove(timeRemaining[0] + j + shift, timeRemaining[0] + j, stack * sizeof(long));
+	memmove(timeRemaining[1] + j + shift, timeRemaining[1] + j, stack * sizeof(long));
+	for(i=0; i<storedGames; i++) savedFramePtr[i] += shift;
+    }
+    for(i=framePtr+1; i<framePtr+1+shift; i++) { // initialize the freed-up entries
+	commentList[i] = NULL;
+	memset(pvInfoList + i, 0, sizeof(ChessProgramStats_Move));
+	boards[i][EP_STATUS] = EP_NONE;
+	for(j=0; j<BOARD_FILES-2; j++) boards[i][CASTLING][j] = NoRights;
+	moveList[i][0] = parseList[i][0] = NULLCHAR;
+	timeRemaining[0][i] = timeRemaining[1][i] = 0;
+    }
+    framePtr += shift; maxMoves = size;
+    gameStorageMoved = TRUE; // windows that keep pointers into the arrays get them again from next HistorySet()
+    return TRUE;
+}
+
 // [HGM] vari: routines for shelving variations
 Boolean modeRestore = FALSE;
 
-void
+Boolean
 PushInner (int firstMove, int lastMove)
-{
+{	// returns FALSE, and leaves the game alone, if there is no room to shelve the moves
 	int i, j, nrMoves = lastMove - firstMove;
 
+	if(!GrowGameStorage(lastMove + nrMoves)) return FALSE; // make sure stack does not run into game
 	// push current tail of game on stack
 	savedResult[storedGames] = gameInfo.result;
 	savedDetails[storedGames] = gameInfo.resultDetails;
@@ -18546,20 +20707,22 @@ PushInner (int firstMove, int lastMove)
 
 	storedGames++;
 	forwardMostMove = firstMove; // truncate game so we can start variation
+	return TRUE;
 }
 
-void
+Boolean
 PushTail (int firstMove, int lastMove)
 {
 	if(appData.icsActive) { // only in local mode
 		forwardMostMove = currentMove; // mimic old ICS behavior
-		return;
+		return TRUE;
 	}
-	if(storedGames >= MAX_VARIATIONS-2) return; // leave one for PV-walk
+	if(storedGames >= MAX_VARIATIONS-2) return FALSE; // leave one for PV-walk
 
-	PushInner(firstMove, lastMove);
+	if(!PushInner(firstMove, lastMove)) return FALSE;
 	if(storedGames == 1) GreyRevert(FALSE);
 	if(gameMode == PlayFromGameFile) gameMode = EditGame, modeRestore = TRUE;
+	return TRUE;
 }
 
 void
@@ -18633,11 +20796,11 @@ CleanupTail ()
 		free(savedDetails[i]);
 	    savedDetails[i] = NULL;
 	}
-	for(i=framePtr; i<MAX_MOVES; i++) {
+	for(i=framePtr; i<maxMoves; i++) {
 		if(commentList[i]) free(commentList[i]);
 		commentList[i] = NULL;
 	}
-	framePtr = MAX_MOVES-1;
+	framePtr = maxMoves-1;
 	storedGames = 0;
 }
 
@@ -18663,7 +20826,7 @@ LoadVariation (int index, char *text)
 	if(appData.debugMode) fprintf(debugFP, "at move %d load variation '%s'\n", currentMove, start);
 	end[1] = NULLCHAR; // clip off comment beyond variation
 	ToNrEvent(currentMove-1);
-	PushTail(currentMove, forwardMostMove); // shelve main variation. This truncates game
+	if(!PushTail(currentMove, forwardMostMove)) return; // shelve main variation. This truncates game
 	// kludge: use ParsePV() to append variation to game
 	move = currentMove;
 	ParsePV(start, TRUE, TRUE);
@@ -69,10 +69,11 @@ extern int currentMove, backwardMostMove, forwardMostMove;
 extern int blackPlaysFirst;
 extern FILE *debugFP;
 extern char* programVersion;
-extern Board boards[];
+extern Board *boards;
+extern int maxMoves;
 extern char marker[BOARD_RANKS][BOARD_FILES];
 extern char lastMsg[MSG_SIZ];
-extern Boolean bookUp;
+extern Boolean bookUp, explorerUp;
 extern Boolean addToBookFlag;
 extern int tinyLayout, smallLayout;
 extern Boolean mcMode;
@@ -176,6 +177,8 @@ void GetMoveListEvent P((void));
 void ExitAnalyzeMode P((void));
 int  AnalyzeModeEvent P((void));
 void AnalyzeFileEvent P((void));
+void AnnotateFileEvent P((void));
+void AnnotateAbortEvent P((void));
 void MatchEvent P((int mode));
 void RecentEngineEvent P((int nr));
 void TypeInEvent P((char first));
@@ -204,6 +207,8 @@ void UnLoadPV P(());
 void MovePV P((int x, int y, int h));
 int PromoScroll P((int x, int y));
 void EditBookEvent P((void));
+void ExplorerEvent P((void));
+char *ExplorerText P((int moveNr));
 Boolean DisplayBook P((int moveNr));
 void SaveToBook P((char *text));
 void AddBookMove P((char *text));
@@ -217,6 +222,7 @@ void ics_printf P((char *format, ...));
 int GetEngineLine P((char *nick, int engine));
 void AddGameToBook P((int always));
 void FlushBook P((void));
+u64 PositionKey P((int moveNr));
 
 char *StrStr P((char *string, char *match));
 char *StrCaseStr P((char *string, char *match));
@@ -339,6 +345,7 @@ typedef struct XB_CPS {
     int sdKludge;    /* 0=use "sd DEPTH" command; 1=use "depth\nDEPTH" */
     int stKludge;    /* 0=use "st TIME" command; 1=use "level 1 TIME" */
     int excludeMoves;/* 0=don't use "exclude" command; 1=do */
+    int resultDeltas;/* pairing engine understands "pairing-result N c" commands */
     char *tidy;
     int matchWins;
     char *variants;
@@ -403,7 +410,7 @@ typedef struct {
   int seen_stat;          /* 1 if we've seen the stat01: line */
 } ChessProgramStats;
 
-extern ChessProgramStats_Move pvInfoList[MAX_MOVES];
+extern ChessProgramStats_Move *pvInfoList;
 extern Boolean shuffleOpenings;
 extern ChessProgramStats programStats;
 extern int opponentKibitzes; // used by wengineo.c
@@ -425,15 +432,17 @@ char *SupportedVariant P((char *list, VariantClass v, int w, int h, int s, int p
 char *CollectPieceDescriptors P((void));
 
 
-/* A point in time */
+/* A point in time (on a monotonic clock where available, so not a date!) */
 typedef struct {
     long sec;  /* Assuming this is >= 32 bits */
     int ms;    /* Assuming this is >= 16 bits */
+    int us;    /* sub-millisecond part, 0-999 */
 } TimeMark;
 
 extern TimeMark programStartTime;
 
 void GetTimeMark P((TimeMark *));
 long SubtractTimeMarks P((TimeMark *, TimeMark *));
+double SubtractTimeMarksMicro P((TimeMark *, TimeMark *));
 
 #endif /* XB_BACKEND */
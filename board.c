@@ -557,6 +557,87 @@ EndAnimation (AnimNr anr, Pnt *finish)
   }
 }
 
+/* Move animations run from a frame timer, so that engine and ICS input
+   is still processed while they play. Board redraws requested in the
+   mean time are held back until the last frame has been shown. */
+
+static struct {
+  ChessSquare piece;
+  int startColor, nFrames, toX, toY, explode;
+  Pnt start, finish, frames[kFactor * 2 + 1];
+} legs[2]; // a Lion double move is animated as two legs
+static int nLegs, curLeg, curFrame;
+static Boolean animating, pendingDraw, pendingRepaint, pendingBoardValid;
+static Board pendingBoard;
+
+static void
+LegDone (int n)
+{
+  int i, j;
+  if(legs[n].explode) { // mark as damaged
+    for(i=0; i<BOARD_WIDTH; i++) for(j=0; j<BOARD_HEIGHT; j++)
+      if((i-legs[n].toX)*(i-legs[n].toX) + (j-legs[n].toY)*(j-legs[n].toY) < 6) damage[0][j][i] |=  1 + ((i-legs[n].toX ^ j-legs[n].toY) & 1);
+  }
+
+  /* Be sure end square is redrawn */
+  damage[0][legs[n].toY][legs[n].toX] |= True;
+}
+
+static void
+StartLeg (int n)
+{
+  curLeg = n; curFrame = 0;
+  BeginAnimation(Game, legs[n].piece, EmptySquare, legs[n].startColor, &legs[n].start);
+}
+
+void
+AnimationTick ()
+{ // frame timer went off: show next frame, or wrap up the leg
+  if(!animating) return;
+  if(curFrame < legs[curLeg].nFrames) {
+    AnimationFrame(Game, &legs[curLeg].frames[curFrame++], legs[curLeg].piece);
+    StartFrameTimer(appData.animSpeed);
+    return;
+  }
+  EndAnimation(Game, &legs[curLeg].finish);
+  LegDone(curLeg);
+  if(curLeg + 1 < nLegs) {
+    StartLeg(curLeg + 1);
+    AnimationTick();
+    return;
+  }
+  animating = False;
+  if(pendingDraw) {
+    pendingDraw = False;
+    DrawPosition(pendingRepaint, pendingBoardValid ? pendingBoard : NULL);
+    pendingRepaint = pendingBoardValid = False;
+  }
+}
+
+void
+FinishAnimation ()
+{ // skip the remaining frames of a running animation, and draw what was held back
+  if(!animating) return;
+  StopFrameTimer();
+  if(curLeg + 1 < nLegs) { // abandon the first leg of a double move
+    EndAnimation(Game, &legs[curLeg].finish);
+    LegDone(curLeg);
+    StartLeg(nLegs - 1);
+  }
+  curFrame = legs[curLeg].nFrames;
+  AnimationTick();
+}
+
+static Boolean
+HoldDrawing (int repaint, Board board)
+{ // called by DrawPosition: remember the board to draw when the animation is done
+  if(!animating) return False;
+  if(board) CopyBoard(pendingBoard, board), pendingBoardValid = True;
+  pendingRepaint |= repaint;
+  pendingDraw = True;
+  return True;
+}
+
 static void
 FrameSequence (AnimNr anr, ChessSquare piece, int startColor, Pnt *start, Pnt *finish, Pnt frames[], int nFrames)
 {
@@ -575,6 +656,7 @@ AnimateAtomicCapture (Board board, int fromX, int fromY, int toX, int toY)
 {
     int i, x, y;
     ChessSquare piece = board[fromY][toY];
+    FinishAnimation();
     board[fromY][toY] = EmptySquare;
     DrawPosition(FALSE, board);
     if (flipView) {
@@ -606,6 +688,8 @@ AnimateMove (Board board, int fromX, int fromY, int toX, int toY)
 
   if(killX >= 0 && IS_LION(board[fromY][fromX])) Roar();
 
+  FinishAnimation(); // a previous move still playing is completed first
+
   /* Are we animating? */
   if (!appData.animate || appData.blindfold)
     return;
@@ -621,6 +705,7 @@ AnimateMove (Board board, int fromX, int fromY, int toX, int toY)
   if (piece >= EmptySquare) return;
 
   if(killX >= 0) toX = killX, toY = killY; // [HGM] lion: first to kill square
+  nLegs = 0;
 
 again:
 
@@ -652,17 +737,27 @@ again:
     Tween(&start, &mid, &finish, kFactor - 1, frames, &nFrames);
   else
     Tween(&start, &mid, &finish, kFactor, frames, &nFrames);
-  FrameSequence(Game, piece, startColor, &start, &finish, frames, nFrames);
-  if(Explode(board, fromX, fromY, toX, toY)) { // mark as damaged
-    int i,j;
-    for(i=0; i<BOARD_WIDTH; i++) for(j=0; j<BOARD_HEIGHT; j++)
-      if((i-toX)*(i-toX) + (j-toY)*(j-toY) < 6) damage[0][j][i] |=  1 + ((i-toX ^ j-toY) & 1);
-  }
-
-  /* Be sure end square is redrawn */
-  damage[0][toY][toX] |= True;
+  legs[nLegs].piece = piece;
+  legs[nLegs].startColor = startColor;
+  legs[nLegs].start = start; legs[nLegs].finish = finish;
+  memcpy(legs[nLegs].frames, frames, nFrames*sizeof(Pnt));
+  legs[nLegs].nFrames = nFrames;
+  legs[nLegs].toX = toX; legs[nLegs].toY = toY;
+  legs[nLegs].explode = Explode(board, fromX, fromY, toX, toY);
+  nLegs++;
 
   if(toX != x || toY != y) { fromX = toX; fromY = toY; toX = x; toY = y; goto again; } // second leg
+
+  if(appData.animSpeed <= 0) { // no delay between frames: nothing to wait for
+    for(curLeg=0; curLeg<nLegs; curLeg++) {
+      FrameSequence(Game, legs[curLeg].piece, legs[curLeg].startColor, &legs[curLeg].start, &legs[curLeg].finish, legs[curLeg].frames, legs[curLeg].nFrames);
+      LegDone(curLeg);
+    }
+    return;
+  }
+  animating = True;
+  StartLeg(0);
+  AnimationTick();
 }
 
 void
@@ -732,6 +827,8 @@ DragPieceBegin (int x, int y, Boolean instantly)
     int	 boardX, boardY, color;
     Pnt corner;
 
+    FinishAnimation(); // the board must show the current position before a piece is picked up
+
     /* Are we animating? */
     if (!appData.animateDragging || appData.blindfold)
       return;
@@ -920,6 +1017,7 @@ DrawPosition (int repaint, Board board)
     int nr = twoBoards*partnerUp;
 
     if(DrawSeekGraph()) return; // [HGM] seekgraph: suppress any drawing if seek graph up
+    if(nr == 0 && HoldDrawing(repaint, board)) return; // wait for move animation to finish
 
     if (board == NULL) {
 	if (!lastBoardValid[nr]) return;
@@ -85,6 +85,10 @@ int SquareColor P((int row, int column));
 void ScreenSquare P((int column, int row, Pnt *pt, int *color));
 void BoardSquare P((int x, int y, int *column, int *row));
 void FrameDelay P((int time));
+void StartFrameTimer P((long millisec));
+int StopFrameTimer P((void));
+void AnimationTick P((void));
+void FinishAnimation P((void));
 void InsertPiece P((AnimNr anr, ChessSquare piece));
 void DrawBlank P((AnimNr anr, int x, int y, int startColor));
 void CopyRectangle P((AnimNr anr, int srcBuf, int destBuf, int srcX, int srcY, int width, int height, int destX, int destY));
@@ -384,6 +384,12 @@ hash (int moveNr)
     return key + holdingsKey;
 }
 
+u64
+PositionKey (int moveNr)
+{   // book key of a position, for use outside the book code
+    return (u64) hash(moveNr);
+}
+
 #define MOVE_BUF 100
 
 // fs routines read from memory buffer if no file specified
@@ -814,7 +820,7 @@ TextToMoves (char *text, int moveNum, entry_t *entries)
 	return count;
 }
 
-Boolean bookUp;
+Boolean bookUp, explorerUp;
 int currentCount;
 
 Boolean
@@ -824,6 +830,12 @@ DisplayBook (int moveNr)
     int count;
     char *p;
     if(!bookUp) return FALSE;
+    if(explorerUp) { // the explorer shares the Edit Book window, but lists the game-list moves
+	p = ExplorerText(moveNr);
+	EditTagsPopUp(p, NULL);
+	free(p);
+	return TRUE;
+    }
     count = currentCount = ReadFromBookFile(moveNr, appData.polyglotBook, entries);
     if(count < 0) return FALSE;
     p = MovesToText(count, entries);
@@ -836,10 +848,17 @@ DisplayBook (int moveNr)
 void
 EditBookEvent()
 {
-      bookUp = TRUE;
+      bookUp = TRUE; explorerUp = FALSE;
 	bookUp = DisplayBook(currentMove);
 }
 
+void
+ExplorerEvent()
+{
+      bookUp = explorerUp = TRUE;
+	DisplayBook(currentMove);
+}
+
 void
 int_to_file (FILE *f, int l, uint64 r)
 {
@@ -863,9 +882,10 @@ void
 SaveToBook (char *text)
 {
     entry_t entries[MOVE_BUF], entry;
-    int count = TextToMoves(text, currentMove, entries);
-    int offset, i, len1=0, len2, readpos=0, writepos=0;
+    int count, offset, i, len1=0, len2, readpos=0, writepos=0;
     FILE *f;
+    if(explorerUp) return; // explorer lists are not a book
+    count = TextToMoves(text, currentMove, entries);
     if(!count && !currentCount) return;
     f=fopen(appData.polyglotBook, "rb+");
     if(!f){	DisplayError(_("Polyglot book not valid"), 0); return; }
@@ -936,7 +956,7 @@ AddToBook (int moveNr, int result)
     uint64 key;
     int i, j, fromY, toY;
     char fromX, toX, promo;
-extern char moveList[][MOVE_LEN];
+extern char (*moveList)[MOVE_LEN];
 
     if(!moveList[moveNr][0] || moveList[moveNr][0] == '\n') return; // could be terminal position
 
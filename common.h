@@ -191,7 +191,7 @@ typedef char *String;
 #define VIRGIN_W                 1             /* [HGM] flags in Board[VIRGIN][X] */
 #define VIRGIN_B                 2
 #define DROP_RANK               -3
-#define MAX_MOVES		1000
+#define MAX_MOVES		256	/* initial size of the game record, which grows as needed */
 #define MSG_SIZ			512
 #define DIALOG_SIZE		256
 #define STAR_MATCH_N            16
@@ -322,7 +322,8 @@ typedef enum {
 #define IS_LION(V)     ((V) == WhiteLion || (V) == BlackLion)
 
 
-typedef ChessSquare Board[BOARD_RANKS][BOARD_FILES];
+typedef short BoardCell; /* ChessSquare, or game-state info in the hidden ranks; TOUCHED needs 16 bits */
+typedef BoardCell Board[BOARD_RANKS][BOARD_FILES];
 
 typedef enum {
     EndOfFile = 0,
@@ -799,6 +800,24 @@ typedef struct {
     Boolean roundSync;
     Boolean cycleSync;
     Boolean numberTag;
+    Boolean creditGuiLag; /* give time GUI spends on handling an engine move back to its clock */
+    float sprtElo0, sprtElo1; /* SPRT hypotheses for Elo difference of first engine */
+    float sprtAlpha, sprtBeta;
+    Boolean sprtStop;     /* end match when SPRT terminates */
+    char *observeSaveFile; /* PGN file for all observed ICS games */
+    char *soundDevice;    /* in-process sound output; "" to always use soundProgram */
+    char *annotateFile;   /* output of batch annotation of the game list */
+    int annotateEngines;  /* number of engine processes used for it */
+    int annotateDepth;    /* search budget per position */
+    int annotateTime;
+    int annotateNodes;
+    char *analysisCache;  /* file shared between instances that remembers analysis results */
+    int analysisCacheSize; /* in MB */
+    int analysisCacheDepth; /* minimum depth of a result to use it */
+    Boolean atomicSave;   /* append games to saveGameFile with a single write, without locking */
+    Boolean saveShards;   /* in match mode save to per-instance copies of saveGameFile */
+    Boolean adjudicateTablebases; /* end games found in the -egtFormats tables */
+    int explorerDepth;  /* moves per side indexed by the opening explorer */
 } AppData, *AppDataPtr;
 
 /*  PGN tags (for showing in the game list) */
@@ -1244,9 +1244,9 @@ changeTags (int n)
 void
 NewTagsPopup (char *text, char *msg)
 {
-    char *title = bookUp ? _("Edit book") : _("Tags");
+    char *title = explorerUp ? _("Opening explorer") : bookUp ? _("Edit book") : _("Tags");
 
-    tagsOptions[2].type = bookUp ? Button : Skip;
+    tagsOptions[2].type = bookUp && !explorerUp ? Button : Skip;
     tagsOptions[3].min = bookUp ? SAME_ROW : 0;
     if(DialogExists(TagsDlg)) { // if already exists, alter title and content
 	SetWidgetText(&tagsOptions[1], text, TagsDlg);
@@ -1256,6 +1256,10 @@ NewTagsPopup (char *text, char *msg)
     tagsOptions[0].name = msg;
     MarkMenu("View.Tags", TagsDlg);
     GenericPopUp(tagsOptions, title, TagsDlg, BoardWindow, NONMODAL, appData.topLevel);
+    // the dialog is reused, so what the explorer cannot use must be hidden after creation
+    if(tagsOptions[2].handle) Show(&tagsOptions[2], tagsOptions[2].type == Skip);
+    if(tagsOptions[3].handle) Show(&tagsOptions[3], explorerUp);
+    SetWidgetEditable(&tagsOptions[1], !explorerUp);
 }
 
 void
@@ -1275,7 +1279,7 @@ void
 TagsPopDown()
 {
     PopDown(TagsDlg);
-    bookUp = False;
+    bookUp = explorerUp = False;
 }
 
 void
@@ -1284,6 +1288,32 @@ EditTagsProc ()
   if (bookUp || !PopDown(TagsDlg)) EditTagsEvent();
 }
 
+//----------------------------- Batch annotation ---------------------------------------
+
+static Option annotateOptions[] = {
+{   0,  0,  250, NULL, NULL, NULL, NULL, Label,  N_("Annotating the game list...") },
+{   0,  0,    0, NULL, (void*) &AnnotateAbortEvent, NULL, NULL, Button, N_("Abort") },
+{ 0, NO_OK|NO_CANCEL, 0, NULL, NULL, "", NULL, EndMark , "" }
+};
+
+void
+AnnotatePopUp ()
+{   // modal, as the games are loaded on the board; closing it also aborts the annotation
+    GenericPopUp(annotateOptions, _("Batch annotation"), TransientDlg, BoardWindow, MODAL, 0);
+}
+
+void
+AnnotatePopDown ()
+{
+    PopDown(TransientDlg);
+}
+
+int
+AnnotateDialogUp ()
+{
+    return shellUp[TransientDlg];
+}
+
 void
 AddBookMove (char *text)
 {
@@ -2830,7 +2860,7 @@ BrowseOK (int n)
 		currentCps = savCps; // could return to Engine Settings dialog!
 		return TRUE;
 	}
-	*savFP = fopen(fileName, savMode);
+	*savFP = OpenPGNFile(fileName, savMode);
 	if(*savFP == NULL) return FALSE; // refuse OK if file not openable
 	ASSIGN(*namePtr, fileName);
 	ScheduleDelayedEvent(DelayedLoad, 50);
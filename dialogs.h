@@ -140,8 +140,10 @@ int GenericReadout P((Option *currentOption, int selected));
 int PopDown P((DialogClass n));
 void MarkMenu P((char *item, int dlgNr));
 int AppendText P((Option *opt, char *s));
+void TruncateText P((Option *opt, int from));
 void AppendColorized P((Option *opt, char *s, int count));
 void Show P((Option *opt, int hide));
+void SetWidgetEditable P((Option *opt, int editable));
 int  IcsHist P((int dir, Option *opt, DialogClass dlg));
 void HighlightText P((Option *opt, int from, int to, Boolean highlight));
 void SetColor P((char *colorName, Option *box));
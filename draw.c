@@ -53,6 +53,8 @@
 
 #include <stdio.h>
 #include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <cairo/cairo.h>
 #include <cairo/cairo-xlib.h>
 #include <librsvg/rsvg.h>
@@ -106,8 +108,8 @@ Boolean cairoAnimate;
 Option *currBoard;
 cairo_surface_t *csBoardWindow;
 static cairo_surface_t *pngPieceImages[2][(int)BlackPawn+4];   // png 256 x 256 images
-static cairo_surface_t *pngPieceBitmaps[2][(int)BlackPawn];    // scaled pieces as used
-static cairo_surface_t *pngPieceBitmaps2[2][(int)BlackPawn+4]; // scaled pieces in store
+static cairo_surface_t *pieceAtlas;                            // scaled pieces in store, white row above black row
+static int pngPieceCells[2][(int)BlackPawn];                   // atlas cells of pieces as used
 static RsvgHandle *svgPieces[2][(int)BlackPawn+4]; // vector pieces in store
 static cairo_surface_t *pngBoardBitmap[2], *pngOriginalBoardBitmap[2];
 int useTexture, textureW[2], textureH[2];
@@ -140,36 +142,36 @@ SelectPieces(VariantClass v)
     for(i=0; i<2; i++) {
 	int p;
 	for(p=0; p<=(int)WhiteKing; p++)
-	   pngPieceBitmaps[i][p] = pngPieceBitmaps2[i][p]; // defaults
+	   pngPieceCells[i][p] = p; // defaults
 	if(v == VariantShogi && BOARD_HEIGHT != 7) { // no exceptions in Tori Shogi
-	   pngPieceBitmaps[i][(int)WhiteCannon] = pngPieceBitmaps2[i][(int)WhiteTokin];
-	   pngPieceBitmaps[i][(int)WhiteNightrider] = pngPieceBitmaps2[i][(int)WhiteKing+2];
-	   pngPieceBitmaps[i][(int)WhiteGrasshopper] = pngPieceBitmaps2[i][(int)WhiteKing+3];
-	   pngPieceBitmaps[i][(int)WhiteSilver] = pngPieceBitmaps2[i][(int)WhiteKing+4];
-	   pngPieceBitmaps[i][(int)WhiteQueen] = pngPieceBitmaps2[i][(int)WhiteLance];
-	   pngPieceBitmaps[i][(int)WhiteFalcon] = pngPieceBitmaps2[i][(int)WhiteMonarch]; // for Sho Shogi
+	   pngPieceCells[i][(int)WhiteCannon] = (int)WhiteTokin;
+	   pngPieceCells[i][(int)WhiteNightrider] = (int)WhiteKing+2;
+	   pngPieceCells[i][(int)WhiteGrasshopper] = (int)WhiteKing+3;
+	   pngPieceCells[i][(int)WhiteSilver] = (int)WhiteKing+4;
+	   pngPieceCells[i][(int)WhiteQueen] = (int)WhiteLance;
+	   pngPieceCells[i][(int)WhiteFalcon] = (int)WhiteMonarch; // for Sho Shogi
 	}
 #ifdef GOTHIC
 	if(v == VariantGothic) {
-	   pngPieceBitmaps[i][(int)WhiteMarshall] = pngPieceBitmaps2[i][(int)WhiteSilver];
+	   pngPieceCells[i][(int)WhiteMarshall] = (int)WhiteSilver;
 	}
 #endif
 	if(v == VariantSChess) {
-	   pngPieceBitmaps[i][(int)WhiteAngel]    = pngPieceBitmaps2[i][(int)WhiteFalcon];
-	   pngPieceBitmaps[i][(int)WhiteMarshall] = pngPieceBitmaps2[i][(int)WhiteAlfil];
+	   pngPieceCells[i][(int)WhiteAngel]    = (int)WhiteFalcon;
+	   pngPieceCells[i][(int)WhiteMarshall] = (int)WhiteAlfil;
 	}
 	if(v == VariantChuChess) {
-	   pngPieceBitmaps[i][(int)WhiteNightrider] = pngPieceBitmaps2[i][(int)WhiteLion];
+	   pngPieceCells[i][(int)WhiteNightrider] = (int)WhiteLion;
 	}
 	if(v == VariantChu) {
-	   pngPieceBitmaps[i][(int)WhiteNightrider] = pngPieceBitmaps2[i][(int)WhiteClaw];
-	   pngPieceBitmaps[i][(int)WhiteClaw]    = pngPieceBitmaps2[i][(int)WhiteNightrider];
-	   pngPieceBitmaps[i][(int)WhiteUnicorn] = pngPieceBitmaps2[i][(int)WhiteHorned];
-	   pngPieceBitmaps[i][(int)WhiteSilver]  = pngPieceBitmaps2[i][(int)WhiteStag];
-	   pngPieceBitmaps[i][(int)WhiteFalcon]  = pngPieceBitmaps2[i][(int)WhiteEagle];
-	   pngPieceBitmaps[i][(int)WhiteHorned]  = pngPieceBitmaps2[i][(int)WhiteUnicorn];
-	   pngPieceBitmaps[i][(int)WhiteStag]    = pngPieceBitmaps2[i][(int)WhiteSilver];
-	   pngPieceBitmaps[i][(int)WhiteEagle]   = pngPieceBitmaps2[i][(int)WhiteFalcon];
+	   pngPieceCells[i][(int)WhiteNightrider] = (int)WhiteClaw;
+	   pngPieceCells[i][(int)WhiteClaw]    = (int)WhiteNightrider;
+	   pngPieceCells[i][(int)WhiteUnicorn] = (int)WhiteHorned;
+	   pngPieceCells[i][(int)WhiteSilver]  = (int)WhiteStag;
+	   pngPieceCells[i][(int)WhiteFalcon]  = (int)WhiteEagle;
+	   pngPieceCells[i][(int)WhiteHorned]  = (int)WhiteUnicorn;
+	   pngPieceCells[i][(int)WhiteStag]    = (int)WhiteSilver;
+	   pngPieceCells[i][(int)WhiteEagle]   = (int)WhiteFalcon;
 	}
     }
 }
@@ -185,6 +187,8 @@ InitDrawingSizes (BoardSize boardSize, int flags)
 
     if(!mainOptions[W_BOARD].handle) return;
 
+    FinishAnimation(); // animation buffers are about to be replaced
+
     if(boardSize == -2 && gameInfo.variant != oldVariant
                        && oldNrOfFiles && oldNrOfFiles != BOARD_WIDTH) { // called because variant switch changed board format
 	squareSize = ((squareSize + lineGap) * oldNrOfFiles + 0.5*BOARD_WIDTH) / BOARD_WIDTH; // keep total width fixed
@@ -333,12 +337,12 @@ LoadSVG (char *dir, int color, int piece, int retry)
     return NULL;
 }
 
-static void
+static int
 ScaleOnePiece (int color, int piece)
-{
+{ // draw the scaled piece image into its atlas cell; returns FALSE if no image could be found
   float w, h;
   char buf[MSG_SIZ];
-  cairo_surface_t *img, *cs;
+  cairo_surface_t *img;
   cairo_t *cr;
 
   g_type_init ();
@@ -367,55 +371,165 @@ ScaleOnePiece (int color, int piece)
 
   img = pngPieceImages[color][piece];
 
-  // create new bitmap to hold scaled piece image (and remove any old)
-  if(pngPieceBitmaps2[color][piece]) cairo_surface_destroy (pngPieceBitmaps2[color][piece]);
-  pngPieceBitmaps2[color][piece] = cs = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, squareSize, squareSize);
+  if(!img) return FALSE;
 
-  if(!img) return;
-
-  // scaled copying of the raw png image
-  cr = cairo_create(cs);
+  // scaled copying of the raw png image into the cell
+  cr = cairo_create(pieceAtlas);
   w = cairo_image_surface_get_width (img);
   h = cairo_image_surface_get_height (img);
+  cairo_translate(cr, piece*squareSize, color*squareSize);
   cairo_scale(cr, squareSize/w, squareSize/h);
+  cairo_rectangle(cr, 0, 0, w, h);
+  cairo_clip(cr); // filtering must not bleed into neighboring cells
   cairo_set_source_surface (cr, img, 0, 0);
   cairo_paint (cr);
   cairo_destroy (cr);
+  return TRUE;
+}
 
-  if(!appData.trueColors || !*appData.pieceDirectory) { // operate on bitmap to color it (king-size hack...)
-    int stride = cairo_image_surface_get_stride(cs)/4;
-    int *buf = (int *) cairo_image_surface_get_data(cs);
-    int i, j, p;
+static void
+RecolorAtlas (int n)
+{ // operate on atlas to color the pieces (king-size hack...), through a table of the replacement color for each weight
+  int stride = cairo_image_surface_get_stride(pieceAtlas)/4, width = n*squareSize;
+  unsigned int *buf = (unsigned int *) cairo_image_surface_get_data(pieceAtlas);
+  unsigned int mix[256];
+  int color, i, j, p;
+
+  if(appData.trueColors && *appData.pieceDirectory) return;
+  cairo_surface_flush(pieceAtlas);
+  for(color=0; color<2; color++) {
     sscanf(color ? appData.blackPieceColor+1 : appData.whitePieceColor+1, "%x", &p); // replacement color
-    cairo_surface_flush(cs);
-    for(i=0; i<squareSize; i++) for(j=0; j<squareSize; j++) {
-	int r, a;
-	float f;
-	unsigned int c = buf[i*stride + j];
-	a = c >> 24; r = c >> 16 & 255;     // alpha and red, where red is the 'white' weight, since white is #FFFFCC in the source images
-        f = (color ? a - r : r)/255.;       // fraction of black or white in the mix that has to be replaced
-	buf[i*stride + j] = c & 0xFF000000; // alpha channel is kept at same opacity
-	buf[i*stride + j] += ((int)(f*(p&0xFF0000)) & 0xFF0000) + ((int)(f*(p&0xFF00)) & 0xFF00) + (int)(f*(p&0xFF)); // add desired fraction of new color
-	if(color) buf[i*stride + j] += r | r << 8 | r << 16; // details on black pieces get their weight added in pure white
+    for(i=0; i<256; i++) { // desired fraction of new color, for each fraction of black or white in the mix
+	float f = i/255.;
+	mix[i] = ((int)(f*(p&0xFF0000)) & 0xFF0000) + ((int)(f*(p&0xFF00)) & 0xFF00) + (int)(f*(p&0xFF));
+    }
+    for(i=color*squareSize; i<(color+1)*squareSize; i++) {
+	unsigned int *row = buf + i*stride;
 	if(appData.monoMode) {
-	    if(a < 64) buf[i*stride + j] = 0; // if not opaque enough, totally transparent
-	    else if(2*r < a) buf[i*stride + j] = 0xFF000000; // if not light enough, totally black
-            else buf[i*stride + j] = 0xFFFFFFFF; // otherwise white
+	    for(j=0; j<width; j++) {
+		unsigned int c = row[j], a = c >> 24, r = c >> 16 & 255;
+		row[j] = (a < 64 ? 0 : 2*r < a ? 0xFF000000 : 0xFFFFFFFF); // transparent, black or white
+	    }
+	} else if(color) { // alpha and red, where red is the 'white' weight, since white is #FFFFCC in the source images
+	    for(j=0; j<width; j++) { // details on black pieces get their weight added in pure white
+		unsigned int c = row[j], r = c >> 16 & 255;
+		row[j] = (c & 0xFF000000) + mix[(c >> 24) - r & 255] + r*0x10101;
+	    }
+	} else {
+	    for(j=0; j<width; j++) {
+		unsigned int c = row[j];
+		row[j] = (c & 0xFF000000) + mix[c >> 16 & 255];
+	    }
 	}
     }
-    cairo_surface_mark_dirty(cs);
   }
+  cairo_surface_mark_dirty(pieceAtlas);
+}
+
+#define ATLAS_CACHE 4
+
+static struct {
+    cairo_surface_t *atlas;
+    unsigned int key;
+    int lastUse;
+} atlasCache[ATLAS_CACHE]; // recently used atlases, so that resizing back or switching themes needs no rendering
+static int atlasClock;
+
+static unsigned int
+HashString (unsigned int h, char *s)
+{
+    while(*s) h = (h ^ *(unsigned char *)s++) * 16777619;
+    return (h ^ 0xFF) * 16777619; // terminator, so that consecutive strings cannot be confused
+}
+
+static unsigned int
+AtlasKey ()
+{ // everything that determines the look of the atlas, apart from the source files
+    unsigned int h = 2166136261u;
+    char buf[MSG_SIZ];
+    snprintf(buf, MSG_SIZ, "%d %d %d", squareSize, appData.monoMode, appData.trueColors);
+    h = HashString(h, buf);
+    h = HashString(h, appData.whitePieceColor);
+    h = HashString(h, appData.blackPieceColor);
+    h = HashString(h, appData.pieceDirectory);
+    return HashString(h, svgDir);
+}
+
+static unsigned int
+SourceKey (unsigned int h, int n)
+{ // add identity (name, size, date) of all files the pieces could be taken from
+    static char *ext[] = { "png", "svg" };
+    char buf[MSG_SIZ], *dir, *name;
+    struct stat s;
+    int color, p, d, e, r;
+    for(p=0; p<n; p++) for(color=0; color<2; color++) for(d=0; d<2; d++) for(e=d; e<2; e++) for(r=0; r<2; r++) {
+	dir = (d ? svgDir : appData.pieceDirectory);
+	name = (r ? (p >= WhiteGrasshopper && p <= WhiteNothing ? backupPiece[p - WhiteGrasshopper] : NULL) : pngPieceNames[p]);
+	if(!*dir || !name) continue;
+	snprintf(buf, MSG_SIZ, "%s/%s%s.%s", dir, color ? "Black" : "White", name, ext[e]);
+	if(stat(buf, &s)) continue;
+	h = HashString(h, buf);
+	snprintf(buf, MSG_SIZ, "%ld %ld", (long) s.st_size, (long) s.st_mtime);
+	h = HashString(h, buf);
+    }
+    return h;
+}
+
+static int
+AtlasFile (char *buf, unsigned int key)
+{ // name of the disk copy of an atlas, in the user's cache directory (created when needed)
+    char *cache = getenv("XDG_CACHE_HOME"), *home = getenv("HOME");
+    char dir[MSG_SIZ];
+    if(cache && *cache) snprintf(dir, MSG_SIZ, "%s/xboard", cache); else
+    if(home && *home) {
+	snprintf(dir, MSG_SIZ, "%s/.cache", home);
+	mkdir(dir, 0700);
+	strncat(dir, "/xboard", MSG_SIZ - strlen(dir) - 1);
+    } else return FALSE;
+    mkdir(dir, 0755);
+    snprintf(buf, MSG_SIZ, "%s/pieces-%d-%08x.png", dir, squareSize, key);
+    return TRUE;
+}
+
+static cairo_surface_t *
+LoadAtlas (char *name, int n)
+{
+    cairo_surface_t *cs = cairo_image_surface_create_from_png(name);
+    if(cairo_surface_status(cs) == CAIRO_STATUS_SUCCESS && cairo_image_surface_get_format(cs) == CAIRO_FORMAT_ARGB32 &&
+       cairo_image_surface_get_width(cs) == n*squareSize && cairo_image_surface_get_height(cs) == 2*squareSize) return cs;
+    cairo_surface_destroy(cs);
+    return NULL;
 }
 
 void
 CreatePNGPieces ()
-{
-  int p;
+{ // make pieceAtlas hold all pieces at the current size and colors, from memory, disk or by rendering
+  unsigned int key = AtlasKey();
+  char buf[MSG_SIZ];
+  int i, n, oldest = 0, found = 0;
 
-  for(p=0; pngPieceNames[p]; p++) {
-    ScaleOnePiece(0, p);
-    ScaleOnePiece(1, p);
+  for(n=0; pngPieceNames[n]; n++);
+  for(i=0; i<ATLAS_CACHE; i++) {
+    if(atlasCache[i].atlas && atlasCache[i].key == key) break;
+    if(atlasCache[i].lastUse < atlasCache[oldest].lastUse) oldest = i;
+  }
+  if(i == ATLAS_CACHE) { // not in memory; take it from disk, or render it
+    unsigned int diskKey = SourceKey(key, n);
+    int file = AtlasFile(buf, diskKey);
+    i = oldest;
+    if(atlasCache[i].atlas) cairo_surface_destroy(atlasCache[i].atlas);
+    if(!file || !(pieceAtlas = LoadAtlas(buf, n))) {
+      int p;
+      pieceAtlas = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, n*squareSize, 2*squareSize);
+      for(p=0; p<n; p++) found += ScaleOnePiece(0, p) + ScaleOnePiece(1, p);
+      RecolorAtlas(n);
+      if(file && found == 2*n) cairo_surface_write_to_png(pieceAtlas, buf); // failure only means no disk cache
+    }
+    atlasCache[i].atlas = pieceAtlas;
+    atlasCache[i].key = key;
   }
+  pieceAtlas = atlasCache[i].atlas;
+  atlasCache[i].lastUse = ++atlasClock;
   SelectPieces(gameInfo.variant);
 }
 
@@ -431,13 +545,18 @@ void
 InitDrawingParams (int reloadPieces)
 {
     int i, p;
-    if(reloadPieces)
+    if(reloadPieces) {
     for(i=0; i<2; i++) for(p=0; p<BlackPawn+4; p++) {
 	if(pngPieceImages[i][p]) cairo_surface_destroy(pngPieceImages[i][p]);
 	pngPieceImages[i][p] = NULL;
 	if(svgPieces[i][p]) rsvg_handle_close(svgPieces[i][p], NULL);
 	svgPieces[i][p] = NULL;
     }
+    for(i=0; i<ATLAS_CACHE; i++) { // the memory copies might be from the old files
+	if(atlasCache[i].atlas) cairo_surface_destroy(atlasCache[i].atlas);
+	atlasCache[i].atlas = NULL;
+    }
+    }
     CreateAnyPieces(1);
 }
 
@@ -689,6 +808,14 @@ BlankSquare (cairo_surface_t *dest, int x, int y, int color, ChessSquare piece,
     }
 }
 
+static void
+PaintPiece (cairo_t *cr, int kind, int piece, int x, int y)
+{   // set the atlas as source for the piece at (x,y), clipped to its cell
+    cairo_set_source_surface (cr, pieceAtlas, x - pngPieceCells[kind][piece]*squareSize, y - kind*squareSize);
+    cairo_rectangle (cr, x, y, squareSize, squareSize);
+    cairo_clip (cr);
+}
+
 static void
 pngDrawPiece (cairo_surface_t *dest, ChessSquare piece, int square_color, int x, int y)
 {
@@ -704,7 +831,7 @@ pngDrawPiece (cairo_surface_t *dest, ChessSquare piece, int square_color, int x,
     if(appData.upsideDown && flipView) kind = 1 - kind; // swap white and black pieces
     BlankSquare(dest, x, y, square_color, piece, 1); // erase previous contents with background
     cr = cairo_create (dest);
-    cairo_set_source_surface (cr, pngPieceBitmaps[kind][piece], x, y);
+    PaintPiece(cr, kind, piece, x, y);
     cairo_paint(cr);
     cairo_destroy (cr);
 }
@@ -854,7 +981,7 @@ CairoOverlayPiece (ChessSquare piece, cairo_surface_t *dest)
 {
   static cairo_t *pieceSource;
   pieceSource = cairo_create (dest);
-  cairo_set_source_surface (pieceSource, pngPieceBitmaps[!White(piece)][piece % BlackPawn], 0, 0);
+  PaintPiece(pieceSource, !White(piece), piece % BlackPawn, 0, 0);
   if(doubleClick) cairo_paint_with_alpha (pieceSource, 0.6);
   else cairo_paint(pieceSource);
   cairo_destroy (pieceSource);
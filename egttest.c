@@ -0,0 +1,143 @@
+/*
+ * egttest.c -- check the adjudication of games by end-game tables
+ *
+ * Copyright 2026 Free Software Foundation, Inc.
+ *
+ * ------------------------------------------------------------------------
+ *
+ * GNU XBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * GNU XBoard is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.  *
+ *
+ *------------------------------------------------------------------------
+ ** See the file ChangeLog for a revision history.  */
+
+/* Runs the back-end without a GUI (see nofrontend.c), compiled with EGT_MOCK so that
+   -egtFormats accepts "mock" tables: a text file with lines "wdl dtz FEN". It writes such
+   a file for the positions below, sets each of them up as the current position of an
+   engine-engine game, and checks how Adjudicate() ends it with -adjudicateTablebases:
+   wins and losses for the side to move, draws, cursed wins and blessed losses, and wins
+   that the 50-move rule would spoil, with and without -ruleMoves.
+   It exits with a non-zero status when any verdict differs, so it can be run by 'make check'.
+
+   usage: egttest [-v]
+*/
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#if HAVE_STRING_H
+# include <string.h>
+#else /* not HAVE_STRING_H */
+# include <strings.h>
+#endif /* not HAVE_STRING_H */
+#if HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+#include "common.h"
+#include "frontend.h"
+#include "backend.h"
+#include "moves.h"
+
+#define TABLE "egttest.tb"
+
+// not in backend.h
+int Adjudicate P((ChessProgramState *cps));
+extern int initialRulePlies, FENrulePlies;
+extern char (*moveList)[MOVE_LEN];
+
+typedef struct {
+    char *fen;      // with the number of reversible plies already played
+    int wdl, dtz;   // what the mock tables say about it, for the side to move
+    int ruleMoves;
+    ChessMove result; // expected verdict, or GameUnfinished for none
+    char *what;
+} Case;
+
+static Case cases[] = {
+  { "4k3/8/4K3/8/8/8/8/Q7 w - - 10 60",    2,   3, 50, WhiteWins,   "win" },
+  { "4k3/8/8/8/8/4K3/8/Q7 b - - 10 60",   -2,   8, 50, WhiteWins,   "loss" },
+  { "3k4/8/3K4/8/8/8/8/7q w - - 10 60",   -2,   5, 50, BlackWins,   "loss, Black wins" },
+  { "4k3/4r3/8/8/8/8/4R3/4K3 w - - 10 60", 0,   0, 50, GameIsDrawn, "draw" },
+  { "8/8/8/8/8/2k5/8/KNB5 w - - 0 60",     1, 120, 50, GameIsDrawn, "cursed win" },
+  { "8/8/8/8/8/5k2/8/1NB1K3 b - - 0 60",  -1, 110, 50, GameIsDrawn, "blessed loss" },
+  { "4k3/8/8/8/8/8/8/R3K3 w - - 70 80",    2,  40, 50, GameIsDrawn, "win spoiled by the 50-move rule" },
+  { "4k3/8/8/8/8/8/8/2R1K3 w - - 50 80",   2,  40, 50, WhiteWins,   "win just in time" },
+  { "4k3/8/8/8/8/8/8/4K2R w - - 10 80",    2,  -1, 50, GameUnfinished, "win without DTZ" },
+  { "8/8/8/8/8/2k5/8/KNB5 w - - 0 60",     1, 120,  0, GameUnfinished, "cursed win without 50-move rule" },
+  { "4k3/8/8/8/8/8/8/R3K3 w - - 70 80",    2,  40,  0, WhiteWins,   "win without 50-move rule" },
+  { "4k3/8/8/8/8/8/8/4K2R w - - 10 80",    2,  -1,  0, WhiteWins,   "win without DTZ or 50-move rule" },
+  { NULL }
+};
+
+static int
+Check (Case *c, int verbose)
+{   // set up the position as if an engine just moved to it, and let the back-end judge it
+    Board board;
+    int btm, n, ended;
+    char *details;
+
+    Reset(FALSE, TRUE);
+    if(!ParseFEN(board, &btm, c->fen, FALSE)) { printf("bad FEN %s\n", c->fen); return 1; }
+    n = btm ? 1 : 2; // leaves a move before it for Adjudicate to relay
+    CopyBoard(boards[n], board);
+    moveList[n-1][0] = NULLCHAR;
+    currentMove = forwardMostMove = backwardMostMove = n;
+    initialRulePlies = FENrulePlies;
+    appData.ruleMoves = c->ruleMoves;
+    gameMode = TwoMachinesPlay;
+    ended = Adjudicate(&first);
+    details = (ended && gameInfo.resultDetails ? gameInfo.resultDetails : "no adjudication");
+    if(verbose || gameInfo.result != c->result || ended != (c->result != GameUnfinished))
+	printf("%-34s ruleMoves %2d: %s\n", c->what, c->ruleMoves, details);
+    if(gameInfo.result == c->result && ended == (c->result != GameUnfinished)) return 0;
+    printf("  expected %s\n", c->result == WhiteWins ? "1-0" : c->result == BlackWins ? "0-1" : c->result == GameIsDrawn ? "1/2-1/2" : "no adjudication");
+    return 1;
+}
+
+int
+main (int argc, char **argv)
+{
+    int i, errors = 0, verbose = (argc > 1 && !strcmp(argv[1], "-v"));
+    FILE *f;
+
+    if((f = fopen(TABLE, "w")) == NULL) { perror(TABLE); return 1; }
+    for(i=0; cases[i].fen; i++) fprintf(f, "%d %d %s\n", cases[i].wdl, cases[i].dtz, cases[i].fen);
+    fclose(f);
+
+    // the options the back-end needs; all others stay off
+    debugFP = stderr;
+    appData.variant = "normal";
+    appData.NrFiles = appData.NrRanks = appData.holdingsSize = -1;
+    appData.testLegality = TRUE;
+    appData.noChessProgram = TRUE;
+    appData.adjudicateTablebases = TRUE;
+    appData.egtFormats = "mock:" TABLE;
+    appData.timeControl = "5"; appData.movesPerSession = 40; appData.timeIncrement = -1;
+    appData.searchTime = appData.pgnName[0] = appData.pgnName[1] = appData.polyglotBook = appData.loadGameFile = appData.loadPositionFile = "";
+    appData.saveGameFile = appData.savePositionFile = appData.featureDefaults = "";
+    for(i=0; i<ENGINES; i++) { // the engine set-up edits these in place
+	appData.chessProgram[i] = strdup(""); appData.host[i] = strdup("localhost"); appData.directory[i] = strdup(".");
+	appData.engInitString[i] = appData.computerString[i] = appData.engOptions[i] = appData.fenOverride[i] = "";
+	appData.protocolVersion[i] = 2; appData.timeOdds[i] = 1;
+    }
+    appData.stretch = 1;
+    InitBackEnd1();
+    Reset(FALSE, TRUE); // the first one only sets the board size, on which the castling ranks depend
+
+    for(i=0; cases[i].fen; i++) errors += Check(&cases[i], verbose);
+
+    unlink(TABLE);
+    if(errors) printf("%d wrong verdicts\n", errors);
+    return errors != 0;
+}
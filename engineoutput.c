@@ -159,48 +159,36 @@ SetEngineState (int which, enum ENGINE_STATE state, char * state_data)
     }
 }
 
-// back end, now the front-end wrapper ClearMemo is used, and ed no longer contains handles.
-void
-SetProgramStats (FrontEndProgramStats * stats) // now directly called by back-end
-{
-    EngineOutputData ed;
-    int clearMemo = FALSE;
-    int which, depth, multi;
-    ChessMove moveType;
-    int ff, ft, rf, rt;
-    char pc;
+// Thinking output is not shown line by line, but collected and put in the memo
+// at most FLUSH_RATE times per second. A line for the same move at the same depth
+// as a line still waiting makes that one superfluous. (Debug file gets all lines.)
 
-    if( stats == 0 ) {
-        SetEngineState( 0, STATE_IDLE, "" );
-        SetEngineState( 1, STATE_IDLE, "" );
-        return;
-    }
+#define FLUSH_RATE  10
+#define MAX_PENDING 32
 
-    if(gameMode == IcsObserving && !appData.icsEngineAnalyze)
-	return; // [HGM] kibitz: shut up engine if we are observing an ICS game
-
-    which = stats->which;
-    depth = stats->depth;
+typedef struct {
+    EngineOutputData ed;
+    int forwardMostMove;
+    char pv[2*MSG_SIZ];
+    char hint[MSG_SIZ];
+} PendingStats;
 
-    if( which < 0 || which > 1 || depth < 0 || stats->time < 0 || stats->pv == 0 ) {
-        return;
-    }
+static PendingStats pending[2][MAX_PENDING];
+static int nrPending[2];
+static int flushScheduled;
 
-    if( !EngineOutputDialogExists() ) {
-        return;
-    }
+// back end, now the front-end wrapper ClearMemo is used, and ed no longer contains handles.
+static void
+ShowProgramStats (PendingStats *p)
+{
+    EngineOutputData ed = p->ed;
+    int clearMemo = FALSE;
+    int which = ed.which, depth = ed.depth, multi;
 
     VerifyDisplayMode();
 
-    ed.which = which;
-    ed.depth = depth;
-    ed.nodes = stats->nodes;
-    ed.score = stats->score;
-    ed.time = stats->time;
-    ed.pv = stats->pv;
-    ed.hint = stats->hint;
-    ed.an_move_index = stats->an_move_index;
-    ed.an_move_count = stats->an_move_count;
+    ed.pv = p->pv;
+    ed.hint = p->hint;
 
     /* Get target control. [HGM] this is moved to front end, which get them from a table */
     if( which == 0 ) {
@@ -210,18 +198,12 @@ SetProgramStats (FrontEndProgramStats * stats) // now directly called by back-en
         ed.name = second.tidy;
     }
 
-    if( ed.pv != 0 && ed.pv[0] == ' ' ) {
-        if( strncmp( ed.pv, " no PV", 6 ) == 0 ) { /* Hack on hack! :-O */
-            ed.pv = "";
-        }
-    }
-
     /* Clear memo if needed */
     if( lastDepth[which] > depth || (lastDepth[which] == depth && depth <= 1 && ed.pv[0]) ) { // no reason to clear if we won't add line
         clearMemo = TRUE;
     }
 
-    if( lastForwardMostMove[which] != forwardMostMove ) {
+    if( lastForwardMostMove[which] != p->forwardMostMove ) {
         clearMemo = TRUE;
     }
 
@@ -247,17 +229,92 @@ SetProgramStats (FrontEndProgramStats * stats) // now directly called by back-en
         }
     }
 
-    if(ed.pv && ed.pv[0] && ParseOneMove(ed.pv, currentMove, &moveType, &ff, &rf, &ft, &rt, &pc))
-	ed.moveKey = (ff<<24 | rf << 16 | ft << 8 | rt) ^ pc*87161;
-    else ed.moveKey = ed.nodes; // kludge to get unique key unlikely to match any move
-
     /* Update */
     lastDepth[which] = depth == 1 && ed.nodes == 0 ? 0 : depth; // [HGM] info-line kudge
-    lastForwardMostMove[which] = forwardMostMove;
+    lastForwardMostMove[which] = p->forwardMostMove;
 
     UpdateControls( &ed );
 }
 
+// back end, called by the front-end timer, and before anything else goes into the memos
+void
+FlushEngineOutput ()
+{
+    int which, i;
+
+    flushScheduled = FALSE;
+    for(which=0; which<2; which++) {
+        if( EngineOutputDialogExists() )
+            for(i=0; i<nrPending[which]; i++) ShowProgramStats(&pending[which][i]);
+        nrPending[which] = 0;
+    }
+}
+
+void
+SetProgramStats (FrontEndProgramStats * stats) // now directly called by back-end
+{
+    PendingStats *p;
+    int which, depth, i;
+    ChessMove moveType;
+    int ff, ft, rf, rt;
+    char pc;
+
+    if( stats == 0 ) {
+        FlushEngineOutput();
+        SetEngineState( 0, STATE_IDLE, "" );
+        SetEngineState( 1, STATE_IDLE, "" );
+        return;
+    }
+
+    if(gameMode == IcsObserving && !appData.icsEngineAnalyze)
+	return; // [HGM] kibitz: shut up engine if we are observing an ICS game
+
+    which = stats->which;
+    depth = stats->depth;
+
+    if( which < 0 || which > 1 || depth < 0 || stats->time < 0 || stats->pv == 0 ) {
+        return;
+    }
+
+    if( !EngineOutputDialogExists() ) {
+        return;
+    }
+
+    // lines waiting for another position would be interpreted in the wrong context later
+    if( nrPending[which] && pending[which][0].forwardMostMove != forwardMostMove ) FlushEngineOutput();
+    if( nrPending[which] == MAX_PENDING ) FlushEngineOutput();
+
+    p = &pending[which][nrPending[which]];
+    p->ed.which = which;
+    p->ed.depth = depth;
+    p->ed.nodes = stats->nodes;
+    p->ed.score = stats->score;
+    p->ed.time = stats->time;
+    p->ed.an_move_index = stats->an_move_index;
+    p->ed.an_move_count = stats->an_move_count;
+    p->forwardMostMove = forwardMostMove;
+    safeStrCpy( p->pv, strncmp( stats->pv, " no PV", 6 ) ? stats->pv : "", sizeof(p->pv) ); /* Hack on hack! :-O */
+    safeStrCpy( p->hint, stats->hint ? stats->hint : "", sizeof(p->hint) );
+
+    if(p->pv[0] && ParseOneMove(p->pv, currentMove, &moveType, &ff, &rf, &ft, &rt, &pc))
+	p->ed.moveKey = (ff<<24 | rf << 16 | ft << 8 | rt) ^ pc*87161;
+    else p->ed.moveKey = p->ed.nodes; // kludge to get unique key unlikely to match any move
+
+    for(i=0; i<nrPending[which]; i++) { // same move at same depth replaces the waiting line
+        PendingStats *q = &pending[which][i];
+        if(q->ed.depth == depth && q->ed.moveKey == p->ed.moveKey && p->pv[0] && q->pv[0]) {
+            memmove(q, q + 1, (nrPending[which] - i) * sizeof(PendingStats)); // new one moves along with rest
+            break;
+        }
+    }
+    if(i == nrPending[which]) nrPending[which]++;
+
+    if( !flushScheduled ) {
+        flushScheduled = TRUE;
+        StartEngineOutputTimer( 1000 / FLUSH_RATE );
+    }
+}
+
 #define ENGINE_COLOR_WHITE      'w'
 #define ENGINE_COLOR_BLACK      'b'
 #define ENGINE_COLOR_UNKNOWN    ' '
@@ -589,7 +646,7 @@ UpdateControls (EngineOutputData *ed)
         for(i=hits=0; i<5; i++) params[i] = 0;
 //fprintf(stderr, "%s\n%s\n", ed->pv, pvStart);
         if(pvStart != ed->pv) { // check if numbers before PV
-            strncpy(buf, ed->pv, 256); buf[pvStart - ed->pv] = NULLCHAR;
+            safeStrCpy(buf, ed->pv, sizeof(buf)); if(pvStart - ed->pv < sizeof(buf)) buf[pvStart - ed->pv] = NULLCHAR;
             extra = sscanf(buf, "%d %d %d %d %d", params, params+1, params+2, params+3, params+4);
 //fprintf(stderr, "extra=%d len=%d\n", extra, pvStart - ed->pv);
             if(extra) hits = params[extra-1], params[extra-1] = 0; // last one is tbhits
@@ -635,9 +692,7 @@ UpdateControls (EngineOutputData *ed)
         /* Add PV */
         buflen = strlen(buf);
 
-        strncpy( buf + buflen, pvStart, sizeof(buf) - buflen );
-
-        buf[ sizeof(buf) - 3 ] = '\0';
+        safeStrCpy( buf + buflen, pvStart, sizeof(buf) - 2 - buflen ); // leave room for the line break
 
         strcat( buf + buflen, "\r\n" );
 
@@ -686,6 +741,7 @@ OutputKibitz (int window, char *text)
 	static int currentLineEnd[2];
 	int where = 0;
 	if(!EngineOutputIsUp()) return;
+	FlushEngineOutput(); // thinking output must go in first
 	if(!opponentKibitzes) { // on first kibitz of game, clear memos
 	    DoClearMemo(1); currentLineEnd[1] = 0;
 	    if(gameMode == IcsObserving) { DoClearMemo(0); currentLineEnd[0] = 0; }
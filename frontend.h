@@ -101,6 +101,7 @@ void PlayIcsUnfinishedSound P((void));
 void PlayAlarmSound P((void));
 void PlayTellSound P((void));
 int  PlaySoundFile P((char *name));
+void PreloadSounds P((void));
 void PlaySoundByColor P((void));
 void EchoOn P((void));
 void EchoOff P((void));
@@ -146,6 +147,7 @@ int OpenTelnet P((char *host, char *port, ProcRef *pr));
 int OpenTCP P((char *host, char *port, ProcRef *pr));
 int OpenCommPort P((char *name, ProcRef *pr));
 int OpenLoopback P((ProcRef *pr));
+int OpenFileWatch P((char *name, ProcRef *pr));
 int OpenRcmd P((char *host, char *user, char *cmd, ProcRef *pr));
 
 typedef void (*InputCallback) P((InputSourceRef isr, VOIDSTAR closure,
@@ -206,6 +208,9 @@ void AnimateMove P((Board board, int fromX, int fromY, int toX, int toY));
 void HistorySet P((char movelist[][2*MOVE_LEN], int first, int last, int current));
 void FreezeUI P((void));
 void ThawUI P((void));
+void AnnotatePopUp P((void));
+void AnnotatePopDown P((void));
+int  AnnotateDialogUp P((void));
 void ChangeDragPiece P((ChessSquare piece));
 void CopyFENToClipboard P((void));
 extern char *programName;
@@ -228,6 +233,10 @@ typedef struct FrontEndProgramStats_TAG {
 } FrontEndProgramStats;
 
 void SetProgramStats P(( FrontEndProgramStats * stats )); /* [AS] */
+void FlushEngineOutput P((void));
+void StartEngineOutputTimer P((long millisec));
+FILE *OpenDebugFile P((char *name));
+FILE *OpenPGNFile P((char *name, char *mode));
 
 void EngineOutputPopUp P((void));
 void EngineOutputPopDown P((void));
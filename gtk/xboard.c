@@ -982,7 +982,7 @@ main (int argc, char **argv)
 
     if (appData.debugMode && appData.nameOfDebugFile && strcmp(appData.nameOfDebugFile, "stderr")) {
 	/* [DM] debug info to file [HGM] make the filename a command-line option, and allow it to remain stderr */
-        if ((debugFP = fopen(appData.nameOfDebugFile, "w")) == NULL)  {
+        if ((debugFP = OpenDebugFile(appData.nameOfDebugFile)) == NULL)  {
            printf(_("Failed to open file '%s'\n"), appData.nameOfDebugFile);
            exit(errno);
         }
@@ -1005,6 +1005,7 @@ main (int argc, char **argv)
     appData.highlightDragging = FALSE;
 #endif
     InitBackEnd1();
+    PreloadSounds();
 
 	gameInfo.variant = StringToVariant(appData.variant);
 	InitPosition(FALSE);
@@ -2272,6 +2273,31 @@ FrameDelay (int time)
 
 #endif
 
+static guint frameTimerTag = 0;
+
+static gboolean
+FrameTimerCallback (gpointer data)
+{
+    frameTimerTag = 0;
+    AnimationTick();
+    return FALSE; // one-shot, the next frame schedules its own
+}
+
+void
+StartFrameTimer (long millisec)
+{
+    frameTimerTag = g_timeout_add(millisec, FrameTimerCallback, NULL);
+}
+
+int
+StopFrameTimer ()
+{
+    if (frameTimerTag == 0) return FALSE;
+    g_source_remove(frameTimerTag);
+    frameTimerTag = 0;
+    return TRUE;
+}
+
 static int
 FindLogo (char *place, char *name, char *buf)
 {   // check if file exists in given place
@@ -2402,7 +2428,7 @@ void FileNamePopUpWrapper(label, def, filter, proc, pathFlag, openMode, name, fp
       filename = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (dialog));
 
       //see loadgamepopup
-      f = fopen(filename, openMode);
+      f = OpenPGNFile(filename, openMode);
       if (f == NULL)
         {
           DisplayError(_("Failed to open file"), errno);
@@ -606,6 +606,13 @@ Show (Option *opt, int hide)
     else     gtk_widget_show(opt->handle);
 }
 
+void
+SetWidgetEditable (Option *opt, int editable)
+{   // only multi-line text boxes, which keep their text view in textValue
+    if(opt->type == TextBox && opt->value > 80 && opt->textValue)
+	gtk_text_view_set_editable(GTK_TEXT_VIEW(opt->textValue), editable);
+}
+
 int
 ShiftKeys ()
 {   // bassic primitive for determining if modifier keys are pressed
@@ -842,19 +849,26 @@ gboolean GenericPopDown(w, resptype, gdata)
 
 int AppendText(Option *opt, char *s)
 {
-    char *v;
     int len;
     GtkTextIter end;
 
-    GetWidgetTextGTK(opt->handle, &v);
-    len = strlen(v);
-    g_free(v);
+    len = gtk_text_buffer_get_char_count(GTK_TEXT_BUFFER(opt->handle)); // offset in characters, as HighlightText expects
     gtk_text_buffer_get_end_iter(GTK_TEXT_BUFFER(opt->handle), &end);
     gtk_text_buffer_insert(opt->handle, &end, s, -1);
 
     return len;
 }
 
+void
+TruncateText (Option *opt, int from)
+{   // delete everything from the given character offset on
+    GtkTextIter start, end;
+
+    gtk_text_buffer_get_iter_at_offset(GTK_TEXT_BUFFER(opt->handle), &start, from);
+    gtk_text_buffer_get_end_iter(GTK_TEXT_BUFFER(opt->handle), &end);
+    gtk_text_buffer_delete(GTK_TEXT_BUFFER(opt->handle), &start, &end);
+}
+
 void
 SetColor (char *colorName, Option *box)
 {       // sets the color of a widget
@@ -147,6 +147,23 @@ CancelDelayedEvent ()
 }
 
 
+guint engineOutputTimerTag = 0;
+
+gboolean
+EngineOutputTimerCallback(gpointer data)
+{
+    engineOutputTimerTag = 0;
+    FlushEngineOutput();
+    return FALSE;
+}
+
+void
+StartEngineOutputTimer (long millisec)
+{
+    if(engineOutputTimerTag) return; // already pending
+    engineOutputTimerTag = g_timeout_add(millisec, (GSourceFunc) EngineOutputTimerCallback, NULL);
+}
+
 guint loadGameTimerTag = 0;
 
 int LoadGameTimerRunning()
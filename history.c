@@ -38,6 +38,7 @@
 
 /* templates for low-level front-end tasks (requiring platform-dependent implementation) */
 void ClearHistoryMemo P((void));                                   // essential
+void TruncateHistoryMemo P((int offset));                          // essential
 int AppendToHistoryMemo P(( char * text, int bold, int colorNr )); // essential (coloring / styling optional)
 void HighlightMove P(( int from, int to, Boolean highlight ));     // optional (can be dummy)
 void ScrollToCurrent P((int caretPos));                            // optional (can be dummy)
@@ -63,11 +64,14 @@ static int currLast = 0;
 static int currCurrent = -1;
 
 typedef struct {
+    int memoStart;  // start of move number (if any)
     int memoOffset;
     int memoLength;
+    char text[2*MOVE_LEN + 32]; // move and annotation as they were rendered
 } HistoryMove;
 
-static HistoryMove histMoves[ MAX_MOVES ];
+static HistoryMove *histMoves; // grows with the game record
+static int histSize;
 
 /* Note: in the following code a "Memo" is a Rich Edit control (it's Delphi lingo) */
 
@@ -118,39 +122,62 @@ OneMoveAppended ()
     return result;
 }
 
+// back-end
+static void
+RenderMove (int index, char *buf, int *moveLength)
+{ // move text plus PV info (if any), as it should appear in the memo
+    safeStrCpy( buf, SavePart( currMovelist[index]) , MOVE_LEN*2 );
+    *moveLength = strlen(buf);
+    strcat( buf, " " );
+
+    if( appData.showEvalInMoveHistory && currPvInfo[index].depth > 0 ) {
+        sprintf( buf + strlen(buf), "{%s%.2f/%d} ",
+            currPvInfo[index].score >= 0 ? "+" : "",
+            currPvInfo[index].score / 100.0,
+            currPvInfo[index].depth );
+    }
+}
+
 // back-end, now that color and font-style are passed as numbers
 static void
 AppendMoveToMemo (int index)
 {
-    char buf[64];
+    char buf[sizeof(histMoves[0].text)];
+    HistoryMove *h;
+    int len;
 
-    if( index < 0 || index >= MAX_MOVES ) {
+    if( index < 0 ) {
         return;
     }
 
-    buf[0] = '\0';
+    if( index >= histSize ) {
+        HistoryMove *p = (HistoryMove *) realloc( histMoves, (index + MAX_MOVES) * sizeof(HistoryMove) );
+        if( p == NULL ) return;
+        histMoves = p;
+        histSize = index + MAX_MOVES;
+    }
+    h = &histMoves[index];
+
+    h->memoStart = -1;
 
     /* Move number */
     if( (index % 2) == 0 ) {
         sprintf( buf, "%d.%s ", (index / 2)+1, index & 1 ? ".." : "" );
-        AppendToHistoryMemo( buf, 1, 0 ); // [HGM] 1 means bold, 0 default color
+        h->memoStart = AppendToHistoryMemo( buf, 1, 0 ); // [HGM] 1 means bold, 0 default color
     }
 
     /* Move text */
-    safeStrCpy( buf, SavePart( currMovelist[index]) , sizeof( buf)/sizeof( buf[0]) );
-    strcat( buf, " " );
+    RenderMove( index, h->text, &len );
+    memcpy( buf, h->text, len + 1 );
+    buf[len+1] = NULLCHAR;
 
-    histMoves[index].memoOffset = AppendToHistoryMemo( buf, 0, 0 );
-    histMoves[index].memoLength = strlen(buf)-1;
+    h->memoOffset = AppendToHistoryMemo( buf, 0, 0 );
+    h->memoLength = len;
+    if( h->memoStart < 0 ) h->memoStart = h->memoOffset;
 
     /* PV info (if any) */
-    if( appData.showEvalInMoveHistory && currPvInfo[index].depth > 0 ) {
-        sprintf( buf, "{%s%.2f/%d} ",
-            currPvInfo[index].score >= 0 ? "+" : "",
-            currPvInfo[index].score / 100.0,
-            currPvInfo[index].depth );
-
-        AppendToHistoryMemo( buf, 0, 1); // [HGM] 1 means gray
+    if( h->text[len+1] ) {
+        AppendToHistoryMemo( h->text + len + 1, 0, 1); // [HGM] 1 means gray
     }
 }
 
@@ -167,11 +194,32 @@ RefreshMemoContent ()
     }
 }
 
+// back-end
+static void
+UpdateMemoContent ()
+{   // the memo still starts with the same moves: only redo it from the first move that renders differently
+    char buf[sizeof(histMoves[0].text)];
+    int i, len;
+
+    for( i=currFirst; i<lastLast && i<currLast; i++ ) {
+        RenderMove( i, buf, &len );
+        if( strcmp( buf, histMoves[i].text ) ) break;
+    }
+
+    if( i < lastLast ) {
+        TruncateHistoryMemo( histMoves[i].memoStart );
+    }
+
+    for( ; i<currLast; i++ ) {
+        AppendMoveToMemo( i );
+    }
+}
+
 // back-end part taken out of HighlightMove to determine character positions
 static void
 DoHighlight (int index, int onoff)
 {
-    if( index >= 0 && index < MAX_MOVES ) {
+    if( index >= 0 && index < histSize ) {
         HighlightMove( histMoves[index].memoOffset,
             histMoves[index].memoOffset + histMoves[index].memoLength, onoff );
     }
@@ -233,6 +281,9 @@ UpdateMoveHistory ()
         else if( OneMoveAppended() ) {
             AppendMoveToMemo( currCurrent );
         }
+        else if( lastFirst == currFirst && lastGames == storedGames && lastLast <= histSize ) {
+            UpdateMemoContent();
+        }
         else {
             RefreshMemoContent();
         }
@@ -244,7 +295,7 @@ UpdateMoveHistory ()
 void
 MoveHistorySet (char movelist[][2*MOVE_LEN], int first, int last, int current, ChessProgramStats_Move * pvInfo)
 {
-    /* [AS] Danger! For now we rely on the movelist parameter being a static variable! */
+    /* [AS] Danger! We keep the movelist and pvInfo pointers; HistorySet() passes them again after GrowGameStorage() moved them */
 
     currMovelist = movelist;
     currFirst = first;
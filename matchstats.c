@@ -0,0 +1,114 @@
+/*
+ * matchstats.c -- Elo and SPRT statistics of engine-engine matches
+ *
+ * Copyright 2026 Free Software Foundation, Inc.
+ *
+ * ------------------------------------------------------------------------
+ *
+ * GNU XBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * GNU XBoard is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.  *
+ *
+ *------------------------------------------------------------------------
+ ** See the file ChangeLog for a revision history.  */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <math.h>
+
+#include "common.h"
+#include "frontend.h"
+#include "backend.h"
+#include "matchstats.h"
+
+MatchStats matchStats = { {0}, 0, 0, 0, -1 };
+
+void
+MatchStatsReset ()
+{
+    int i;
+    for(i=0; i<5; i++) matchStats.pairs[i] = 0;
+    matchStats.wins = matchStats.draws = matchStats.losses = 0;
+    matchStats.pending = -1;
+}
+
+void
+MatchStatsAdd (int halfPoints)
+{   // record result of a game, as the number of half-points (0-2) the first engine scored
+    if(halfPoints == 2) matchStats.wins++; else
+    if(halfPoints == 1) matchStats.draws++; else matchStats.losses++;
+    if(matchStats.pending < 0) matchStats.pending = halfPoints; // first game of pair
+    else matchStats.pairs[matchStats.pending + halfPoints]++, matchStats.pending = -1;
+}
+
+static double
+ScoreToElo (double score)
+{
+    if(score <= 0.) return -999.;
+    if(score >= 1.) return 999.;
+    return -400. * log10(1./score - 1.);
+}
+
+static double
+EloToScore (double elo)
+{
+    return 1. / (1. + pow(10., -elo/400.));
+}
+
+int
+MatchStatsEstimate (MatchEstimate *e)
+{   // calculate Elo, LOS and SPRT LLR from the pentanomial counts; returns FALSE if there are too few data
+    int i, n = 0;
+    double mean = 0., var = 0., sigma, s0, s1, alpha = appData.sprtAlpha, beta = appData.sprtBeta;
+
+    for(i=0; i<5; i++) n += matchStats.pairs[i], mean += matchStats.pairs[i] * i/4.;
+    e->n = n;
+    if(n == 0) return FALSE;
+    mean /= n;
+    for(i=0; i<5; i++) var += matchStats.pairs[i] * (i/4. - mean) * (i/4. - mean);
+    var /= n;                   // variance of the score of a single pair
+    sigma = sqrt(var / n);      // standard error of the mean
+    e->score = mean;
+    e->elo = ScoreToElo(mean);
+    e->eloMin = ScoreToElo(mean - 1.96*sigma);
+    e->eloMax = ScoreToElo(mean + 1.96*sigma);
+    e->los = (sigma > 0. ? 0.5 * (1. + erf((mean - 0.5) / (sigma * sqrt(2.)))) : mean > 0.5 ? 1. : mean < 0.5 ? 0. : 0.5);
+    if(alpha <= 0. || alpha >= 1.) alpha = 0.05;
+    if(beta <= 0. || beta >= 1.) beta = 0.05;
+    e->lower = log(beta / (1. - alpha));
+    e->upper = log((1. - beta) / alpha);
+    // generalized SPRT (normal approximation) for logistic Elo elo0 against elo1
+    s0 = EloToScore(appData.sprtElo0); s1 = EloToScore(appData.sprtElo1);
+    e->llr = (var > 0. ? n * (s1 - s0) * (2.*mean - s0 - s1) / (2.*var) : 0.);
+    return TRUE;
+}
+
+int
+MatchStatsSPRT ()
+{   // returns 1 if SPRT accepts H1 (elo1), -1 if it accepts H0 (elo0), 0 if undecided
+    MatchEstimate e;
+    if(!MatchStatsEstimate(&e)) return 0;
+    if(e.llr >= e.upper) return 1;
+    if(e.llr <= e.lower) return -1;
+    return 0;
+}
+
+char *
+MatchStatsText (char *buf, int size)
+{   // short summary for window title and messages
+    MatchEstimate e;
+    if(!MatchStatsEstimate(&e)) { *buf = NULLCHAR; return buf; }
+    snprintf(buf, size, "Elo %+.1f [%+.1f,%+.1f] LOS %.1f%% LLR %.2f (%.2f,%.2f)",
+	     e.elo, e.eloMin, e.eloMax, 100.*e.los, e.llr, e.lower, e.upper);
+    return buf;
+}
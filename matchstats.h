@@ -0,0 +1,52 @@
+/*
+ * matchstats.h -- Elo and SPRT statistics of engine-engine matches
+ *
+ * Copyright 2026 Free Software Foundation, Inc.
+ *
+ * ------------------------------------------------------------------------
+ *
+ * GNU XBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * GNU XBoard is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.  *
+ *
+ *------------------------------------------------------------------------
+ ** See the file ChangeLog for a revision history.
+ */
+
+#ifndef XB_MATCHSTATS
+#define XB_MATCHSTATS
+
+/* Games are grouped in pairs (normally the same opening with reversed colors),
+   and counted by the number of half-points the first engine scored in them (0-4) */
+typedef struct {
+    int pairs[5];      /* pentanomial frequencies */
+    int wins, draws, losses;
+    int pending;       /* score of first game of incomplete pair, or -1 */
+} MatchStats;
+
+typedef struct {
+    int n;             /* number of complete pairs */
+    double score;      /* average score per game of the first engine */
+    double elo, eloMin, eloMax; /* estimate with 95% confidence interval */
+    double los;        /* likelihood of superiority */
+    double llr, lower, upper;   /* SPRT log-likelihood ratio and its bounds */
+} MatchEstimate;
+
+extern MatchStats matchStats;
+
+void MatchStatsReset P((void));
+void MatchStatsAdd P((int halfPoints));
+int MatchStatsEstimate P((MatchEstimate *e));
+int MatchStatsSPRT P((void));
+char *MatchStatsText P((char *buf, int size));
+
+#endif
@@ -376,9 +376,8 @@ DebugProc ()
     if(!strcmp(appData.nameOfDebugFile, "stderr")) return; // stderr is already open, and should never be closed
     if(!appData.debugMode) fclose(debugFP);
     else {
-	debugFP = fopen(appData.nameOfDebugFile, "w");
+	debugFP = OpenDebugFile(appData.nameOfDebugFile);
 	if(debugFP == NULL) debugFP = stderr;
-	else setbuf(debugFP, NULL);
     }
 }
 
@@ -622,6 +621,7 @@ MenuItem editMenu[] = {
   {N_("Edit Tags"),       NULL,            "EditTags",      EditTagsProc},
   {N_("Edit Comment"),    NULL,            "EditComment",   EditCommentProc},
   {N_("Edit Book"),       NULL,            "EditBook",      EditBookEvent},
+  {N_("Opening Explorer"), NULL,           "OpeningExplorer", ExplorerEvent},
   {"----",                NULL,             NULL,           NothingProc},
   {N_("Revert"),         "Home",           "Revert",        RevertProc},
   {N_("Annotate"),        NULL,            "Annotate",      AnnotateProc},
@@ -1419,7 +1419,8 @@ GenLegal (Board board, int  flags, MoveCallback callback, VOIDSTAR closure, Ches
     GenLegalClosure cl;
     int ff, ft, k, left, right, swap;
     int ignoreCheck = (flags & F_IGNORE_CHECK) != 0;
-    ChessSquare wKing = WhiteKing, bKing = BlackKing, *castlingRights = board[CASTLING];
+    ChessSquare wKing = WhiteKing, bKing = BlackKing;
+    BoardCell *castlingRights = board[CASTLING];
     int inCheck = !ignoreCheck && CheckTest(board, flags, -1, -1, -1, -1, FALSE); // kludge alert: this would mark pre-existing checkers if status==1
     char *p;
 
@@ -2519,7 +2520,7 @@ ProtectedCallback (Board board, int flags, ChessMove kind, int rf, int ff, int r
 	fprintf(debugFP, "try %c%c%c%c=%d\n", ff+AAA, rf+ONE,ft+AAA, rt+ONE, cl->recaptures);
 }
 
-extern char moveList[MAX_MOVES][MOVE_LEN];
+extern char (*moveList)[MOVE_LEN];
 
 int
 PerpetualChase (int first, int last)
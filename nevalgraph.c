@@ -181,7 +181,7 @@ EvalGraphProc ()
 void
 EvalGraphSet (int first, int last, int current, ChessProgramStats_Move * pvInfo)
 {
-    /* [AS] Danger! For now we rely on the pvInfo parameter being a static variable! */
+    /* [AS] Danger! We keep the pvInfo pointer; HistorySet() passes it again after GrowGameStorage() moved it */
 
     currFirst = first;
     currLast = last;
@@ -54,6 +54,12 @@ ClearHistoryMemo ()
     SetWidgetText(&historyOptions[0], "", HistoryDlg);
 }
 
+void
+TruncateHistoryMemo (int offset)
+{
+    TruncateText(&historyOptions[0], offset);
+}
+
 // the bold argument says 0 = normal, 1 = bold typeface
 // the colorNr argument says 0 = font-default, 1 = gray
 int
@@ -0,0 +1,177 @@
+/*
+ * nofrontend.c -- do-nothing front-end, for running the back-end without a GUI
+ *
+ * Copyright 2026 Free Software Foundation, Inc.
+ *
+ * ------------------------------------------------------------------------
+ *
+ * GNU XBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * GNU XBoard is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.  *
+ *
+ *------------------------------------------------------------------------
+ ** See the file ChangeLog for a revision history.  */
+
+/* Everything backend.c and its companions expect from the front-end and the
+   generic dialogs, with displays and windows doing nothing and messages going
+   to stderr. Linked with the back-end this gives a program that can load,
+   search and save games without a display, for tools like pgnbench.       */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "common.h"
+#include "frontend.h"
+#include "backend.h"
+#include "xboard2.h"
+
+// variables of the front-end and the dialogs
+int squareSize = 49, lineGap = 1, smallLayout, tinyLayout, commentUp, errorExitStatus = -1;
+int fromX = -1, fromY = -1, toX, toY;
+char *programName = "xboard", *programVersion, *firstChessProgramNames, *icsNames;
+char *engineName, *engineDir, *engineLine, *nickName, *params;
+Boolean isUCI, hasBook, storeVariant, v1, addToList, useNick;
+char installDir[] = ".";
+
+// messages
+void DisplayMessage (String message, String extMessage) {}
+void DisplayTitle (String title) {}
+void DisplayIcsInteractionTitle (String title) {}
+void DisplayMoveError (String message) { fprintf(stderr, "%s\n", message); }
+void DisplayError (String message, int error) { fprintf(stderr, "%s\n", message); }
+void DisplayInformation (String message) { fprintf(stderr, "%s\n", message); }
+void DisplayNote (String message) { fprintf(stderr, "%s\n", message); }
+void DisplayFatalError (String message, int error, int status) { fprintf(stderr, "%s\n", message); exit(status); }
+void ErrorPopDown () {}
+void AskQuestion (String title, String question, String replyPrefix, ProcRef pr) {}
+void OutputChatMessage (int partner, char *mess) {}
+void OutputKibitz (int window, char *text) {}
+void RingBell () {}
+void PlayAlarmSound () {}
+void PlayIcsWinSound () {}
+void PlayIcsLossSound () {}
+void PlayIcsDrawSound () {}
+void PlayIcsUnfinishedSound () {}
+void PlayTellSound () {}
+void EchoOn () {}
+void EchoOff () {}
+void Colorize (ColorClass cc, int continuation) {}
+char *Col2Text (int n) { return ""; }
+
+// board display
+void DrawPosition (int fullRedraw, Board board) {}
+void InitDrawingSizes (int i, int j) {}
+void AnimateMove (Board board, int fromX, int fromY, int toX, int toY) {}
+void AnimateAtomicCapture (Board board, int fromX, int fromY, int toX, int toY) {}
+void DragPieceBegin (int x, int y, Boolean instantly) {}
+void DragPieceEnd (int x, int y) {}
+void ChangeDragPiece (ChessSquare piece) {}
+int  EventToSquare (int x, int limit) { return -1; }
+void SetHighlights (int fromX, int fromY, int toX, int toY) {}
+void ClearHighlights () {}
+void SetPremoveHighlights (int fromX, int fromY, int toX, int toY) {}
+void ClearPremoveHighlights () {}
+void DrawSeekAxis (int x, int y, int xTo, int yTo) {}
+void DrawSeekBackground (int left, int top, int right, int bottom) {}
+void DrawSeekText (char *buf, int x, int y) {}
+void DrawSeekDot (int x, int y, int color) {}
+void UpdateLogos (int display) {}
+void ActivateTheme (int new) {}
+void BoardToTop () {}
+
+// clocks and timers
+void DisplayWhiteClock (long timeRemaining, int highlight) {}
+void DisplayBlackClock (long timeRemaining, int highlight) {}
+void StartClockTimer (long millisec) {}
+int  StopClockTimer () { return FALSE; }
+void StartLoadGameTimer (long millisec) {}
+int  StopLoadGameTimer () { return FALSE; }
+void StartAnalysisClock () {}
+void ScheduleDelayedEvent (DelayedEventCallback cb, long millisec) {}
+DelayedEventCallback GetDelayedEvent () { return NULL; }
+void CancelDelayedEvent () {}
+void DoEvents () {}
+void DoSleep (int n) {}
+
+// modes and menus
+void ModeHighlight () {}
+void SetICSMode () {}
+void SetGNUMode () {}
+void SetNCPMode () {}
+void SetCmailMode () {}
+void SetTrainingModeOn () {}
+void SetTrainingModeOff () {}
+void SetUserThinkingEnables () {}
+void SetMachineThinkingEnables () {}
+void GreyRevert (Boolean grey) {}
+void FreezeUI () {}
+void ThawUI () {}
+void ResetFrontEnd () {}
+void NotifyFrontendLogin () {}
+void ShutDownFrontEnd () {}
+
+// dialogs
+void CommentPopUp (String title, String comment) {}
+void CommentPopDown () {}
+void EditCommentPopUp (int index, String title, String text) {}
+void TagsPopUp (char *tags, char *msg) {}
+void TagsPopDown () {}
+void EditTagsPopUp (char *tags, char **dest) {}
+void AddBookMove (char *text) {}
+void PromotionPopUp (char choice) {}
+void PopUpMoveDialog (char first) {}
+void SettingsPopUp (ChessProgramState *cps) {}
+void GameListPopUp (FILE *fp, char *filename) {}
+void GameListDestroy () {}
+void GameListHighlight (int index) {}
+void AnnotatePopUp () {}
+void AnnotatePopDown () {}
+int  AnnotateDialogUp () { return TRUE; }
+void GLT_ClearList () {}
+void GLT_DeSelectList () {}
+void GLT_AddToList (char *name) {}
+Boolean GLT_GetFromList (int index, char *name) { return FALSE; }
+void MoveHistorySet (char movelist[][2*MOVE_LEN], int first, int last, int current, ChessProgramStats_Move *pvInfo) {}
+void EvalGraphSet (int first, int last, int current, ChessProgramStats_Move *pvInfo) {}
+void SetProgramStats (FrontEndProgramStats *stats) {}
+int  EngineOutputIsUp () { return FALSE; }
+void EngineOutputPopUp () {}
+void MakeEngineOutputTitle () {}
+void Collapse (int colNr) {}
+void CopyFENToClipboard () {}
+void AutoSaveGame () {}
+Boolean GetArgValue (char *name) { return FALSE; }
+void ParseArgsFromString (char *p) {}
+void ParseArgsFromFile (FILE *f) {}
+
+// files and processes
+FILE *OpenPGNFile (char *name, char *mode) { return fopen(name, mode); }
+FILE *OpenDebugFile (char *name) { return fopen(name, "w"); }
+FILE *GameFile () { return NULL; }
+char *UserName () { return "user"; }
+char *HostName () { return "localhost"; }
+int  ICSInitScript () { return FALSE; }
+void RunCommand (char *buf) {}
+int  StartChildProcess (char *cmdLine, char *dir, ProcRef *pr) { return -1; }
+void DestroyChildProcess (ProcRef pr, int signal) {}
+int  OpenTelnet (char *host, char *port, ProcRef *pr) { return -1; }
+int  OpenTCP (char *host, char *port, ProcRef *pr) { return -1; }
+int  OpenCommPort (char *name, ProcRef *pr) { return -1; }
+int  OpenLoopback (ProcRef *pr) { return -1; }
+int  OpenRcmd (char *host, char *user, char *cmd, ProcRef *pr) { return -1; }
+int  OpenFileWatch (char *name, ProcRef *pr) { return -1; }
+InputSourceRef AddInputSource (ProcRef pr, int lineByLine, InputCallback func, VOIDSTAR closure) { return NULL; }
+void RemoveInputSource (InputSourceRef isr) {}
+int  OutputToProcess (ProcRef pr, char *message, int count, int *outError) { *outError = 0; return count; }
+int  OutputToProcessDelayed (ProcRef pr, char *message, int count, int *outError, long msdelay) { *outError = 0; return count; }
+void CmailSigHandlerCallBack (InputSourceRef isr, VOIDSTAR closure, char *buf, int count, int error) {}
@@ -31,7 +31,7 @@
 #include "moves.h"
 
 
-extern Board	boards[MAX_MOVES];
+extern Board	*boards;
 extern int	PosFlags(int nr);
 int		yyboardindex;
 int             yyskipmoves = FALSE;
@@ -833,7 +833,7 @@ yylex ()
     if(p == yytext) return result;   // kludge to allow kanji expansion
     while(p < parsePtr) *q++ = *p++; // copy the matched text to yytext[]
     *q = NULLCHAR;
-    lastChar = q[-1];
+    if(q > yytext) lastChar = q[-1];
     return result;
 }
 
@@ -0,0 +1,383 @@
+/*
+ * perft.c -- count and time the move-generator of moves.c
+ *
+ * Copyright 2026 Free Software Foundation, Inc.
+ *
+ * ------------------------------------------------------------------------
+ *
+ * GNU XBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * GNU XBoard is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.  *
+ *
+ *------------------------------------------------------------------------
+ ** See the file ChangeLog for a revision history.  */
+
+/* Runs perft (the number of legal move sequences of a given length) with GenLegal from moves.c
+   on a set of positions, compares the node counts with the reference counts, and reports the
+   speed in nodes per second. It also times single calls of GenPseudoLegal, GenLegal, CheckTest
+   and MateTest on each position. The built-in positions have their counts in the table below;
+   other positions can be read from a file in the usual perft-suite format,
+   "FEN ;D1 20 ;D2 400 ...", for the variant given with -v.
+   It exits with a non-zero status when any count differs, so it can be run by 'make check'.
+
+   usage: perft [-d maxDepth] [-v variant] [-f file] [-q]
+*/
+
+#include "config.h"
+
+#include <stdio.h>
+#include <ctype.h>
+#include <stdlib.h>
+#if HAVE_STRING_H
+# include <string.h>
+#else /* not HAVE_STRING_H */
+# include <strings.h>
+#endif /* not HAVE_STRING_H */
+#include <time.h>
+#include "common.h"
+#include "backend.h"
+#include "moves.h"
+
+// the globals moves.c expects from the back-end and parser
+AppData appData;
+GameInfo gameInfo;
+Board initialPosition, *boards;
+char (*moveList)[MOVE_LEN];
+FILE *debugFP;
+int killX = -1, killY = -1, legNr = 1, kifu;
+
+#define MAX_PLY   16
+#define MAX_GEN  512
+#define MAX_DEPTH 10
+
+typedef struct {
+    char *name;
+    VariantClass variant;
+    int width, height;
+    char *pieces;      // piece-to-char table, as set by InitPosition
+    char *promotions;  // what Pawns can promote to
+    int flags;         // castling type
+} VariantInfo;
+
+static VariantInfo variants[] = {
+  { "normal",      VariantNormal,       8,  8, "PNBRQ...........Kpnbrq...........k", "QRBN",   F_ALL_CASTLE_OK },
+  { "fischerandom",VariantFischeRandom, 8,  8, "PNBRQ...........Kpnbrq...........k", "QRBN",   F_FRC_TYPE_CASTLING },
+  { "capablanca",  VariantCapablanca,  10,  8, "PNBRQ..ACKpnbrq..ack",               "QRBNAC", F_ALL_CASTLE_OK },
+  { "gothic",      VariantGothic,      10,  8, "PNBRQ..ACKpnbrq..ack",               "QRBNAC", F_ALL_CASTLE_OK },
+  { "caparandom",  VariantCapaRandom,  10,  8, "PNBRQ..ACKpnbrq..ack",               "QRBNAC", F_FRC_TYPE_CASTLING },
+  { "shatranj",    VariantShatranj,     8,  8, "PN.R.QB...Kpn.r.qb...k",             "Q",      0 },
+  { "makruk",      VariantMakruk,       8,  8, "PN.R.M....SKpn.r.m....sk",           "M",      0 },
+  { "xiangqi",     VariantXiangqi,      9, 10, "PH.R.AE..K.C.ph.r.ae..k.c.",         "",       0 },
+  { NULL }
+};
+
+typedef struct {
+    char *variant, *fen;
+    long long nodes[MAX_DEPTH+1]; // reference count per depth, from 1, 0-terminated
+} Position;
+
+static Position positions[] = {
+  { "normal", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    { 20, 400, 8902, 197281, 4865609 } },
+  { "normal", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    { 48, 2039, 97862, 4085603 } },
+  { "normal", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    { 14, 191, 2812, 43238, 674624 } },
+  { "normal", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    { 6, 264, 9467, 422333 } },
+  { "normal", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    { 44, 1486, 62379, 2103487 } },
+  { "fischerandom", "bqnb1rkr/pp3ppp/3ppn2/2p5/5P2/P2P4/NPP1P1PP/BQ1BNRKR w HFhf - 2 9",
+    { 21, 528, 12189, 326672 } },
+  { "capablanca", "rnabqkbcnr/pppppppppp/10/10/10/10/PPPPPPPPPP/RNABQKBCNR w KQkq - 0 1",
+    { 28, 784, 25228, 805128 } },
+  { "shatranj", "rnbkqbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBKQBNR w - - 0 1",
+    { 16, 256, 4176, 68122 } },
+  { "makruk", "rnsmksnr/8/pppppppp/8/8/PPPPPPPP/8/RNSKMSNR w - - 0 1",
+    { 23, 529, 12012, 273026 } },
+  // moves.c does not confine King and Advisors to the palace, so these are higher than the usual 44, 1920, 79666
+  { "xiangqi", "rheakaehr/9/1c5c1/p1p1p1p1p/9/9/P1P1P1P1P/1C5C1/9/RHEAKAEHR w - - 0 1",
+    { 46, 2098, 91350, 3958056 } },
+  { NULL }
+};
+
+static VariantInfo *vi;
+static int baseFlags;
+
+typedef struct {
+    int nr;
+    struct { ChessMove kind; char rf, ff, rt, ft; } move[MAX_GEN];
+} MoveList;
+
+static MoveList lists[MAX_PLY];
+
+char *
+safeStrCpy (char *dst, const char *src, size_t count)
+{
+    strncpy(dst, src, count); dst[count-1] = NULLCHAR;
+    return dst;
+}
+
+int
+ToLower (int c)
+{
+    return isupper(c) ? tolower(c) : c;
+}
+
+int
+ToUpper (int c)
+{
+    return islower(c) ? toupper(c) : c;
+}
+
+int
+PosFlags (int index)
+{
+    return baseFlags | ((index & 1) == 0 ? F_WHITE_ON_MOVE : 0);
+}
+
+static void
+SetPieces (char *map)
+{   // same as SetCharTable for a map of even length
+    int i, n = strlen(map)/2 - 1;
+    for(i=0; i<(int) EmptySquare; i++) pieceToChar[i] = '.';
+    for(i=0; i<n; i++) pieceToChar[i] = map[i], pieceToChar[WHITE_TO_BLACK i] = map[n+1+i];
+    pieceToChar[WhiteKing] = map[n]; pieceToChar[BlackKing] = map[2*n+1];
+}
+
+static VariantInfo *
+SetVariant (char *name)
+{
+    VariantInfo *v;
+    for(v = variants; v->name; v++) if(!strcmp(v->name, name)) break;
+    if(!v->name) return NULL;
+    gameInfo.variant = v->variant;
+    gameInfo.boardWidth = v->width; gameInfo.boardHeight = v->height;
+    gameInfo.holdingsWidth = gameInfo.holdingsSize = 0;
+    SetPieces(v->pieces);
+    baseFlags = v->flags;
+    return v;
+}
+
+static int
+ReadFEN (Board board, int *btm, char *fen)
+{   // only what perft needs: placement, side to move, castling rights and e.p. square
+    int r, f, i;
+    char *p = fen;
+
+    for(r=0; r<BOARD_RANKS; r++) for(f=0; f<BOARD_FILES; f++) board[r][f] = EmptySquare;
+    for(r=BOARD_HEIGHT-1; r>=0; r--) {
+	for(f=BOARD_LEFT; f<BOARD_RGHT && *p && *p != '/' && *p != ' '; p++) {
+	    if(isdigit(*p)) f += strtol(p, &p, 10), p--;
+	    else if((board[r][f++] = CharToPiece(*p)) == EmptySquare) return 0;
+	}
+	if(*p == '/') p++;
+    }
+    while(*p == ' ') p++;
+    *btm = (*p++ == 'b');
+    while(*p == ' ') p++;
+    for(i=0; i<8; i++) board[CASTLING][i] = NoRights;
+    for(; *p && *p != ' '; p++) { // castling: KQkq for the outer Rooks, or the Rook files
+	int black = islower(*p) != 0, rank = black ? BOARD_HEIGHT-1 : 0, c = ToUpper(*p), king;
+	ChessSquare k = black ? BlackKing : WhiteKing, rook = black ? BlackRook : WhiteRook;
+	for(king=BOARD_LEFT; king<BOARD_RGHT; king++) if(board[rank][king] == k) break;
+	if(king == BOARD_RGHT) continue;
+	if(c == 'K') for(f=BOARD_RGHT-1; f>king && board[rank][f] != rook; f--); else
+	if(c == 'Q') for(f=BOARD_LEFT; f<king && board[rank][f] != rook; f++); else
+	if(c >= 'A' && c < 'A' + BOARD_RGHT - BOARD_LEFT) f = c - 'A' + BOARD_LEFT; else continue;
+	board[CASTLING][2 + 3*black] = king;
+	board[CASTLING][(f < king) + 3*black] = f;
+    }
+    while(*p == ' ') p++;
+    board[EP_STATUS] = (*p >= 'a' && *p <= 'z') ? *p - 'a' + BOARD_LEFT : EP_NONE;
+    return 1;
+}
+
+static void
+Collect (Board board, int flags, ChessMove kind, int rf, int ff, int rt, int ft, VOIDSTAR closure)
+{
+    MoveList *l = (MoveList *) closure;
+    char *p = vi->promotions;
+    do { // one entry per promotion choice
+	l->move[l->nr].kind = kind;
+	l->move[l->nr].rf = rf; l->move[l->nr].ff = ff; l->move[l->nr].rt = rt; l->move[l->nr].ft = ft;
+	if(l->nr < MAX_GEN-1) l->nr++;
+    } while((kind == WhitePromotion || kind == BlackPromotion) && *p && *++p);
+}
+
+static void
+MakeMove (Board board, ChessMove kind, int rf, int ff, int rt, int ft, int promo)
+{   // the part of ApplyMove the supported variants need
+    ChessSquare piece = board[rf][ff];
+    int i, rank = BOARD_HEIGHT-1, black = (piece >= BlackPawn);
+
+    board[EP_STATUS] = EP_NONE;
+    for(i=0; i<6; i++) // moving or capturing a King or Rook destroys its castling rights
+	if(board[CASTLING][i] != NoRights && (i < 3 ? 0 : rank) == rf && board[CASTLING][i] == ff ||
+	   board[CASTLING][i] != NoRights && (i < 3 ? 0 : rank) == rt && board[CASTLING][i] == ft) board[CASTLING][i] = NoRights;
+    if(piece == WhiteKing) board[CASTLING][0] = board[CASTLING][1] = board[CASTLING][2] = NoRights;
+    if(piece == BlackKing) board[CASTLING][3] = board[CASTLING][4] = board[CASTLING][5] = NoRights;
+    switch(kind) {
+      case WhiteKingSideCastle: case WhiteKingSideCastleWild: case BlackKingSideCastle: case BlackKingSideCastleWild:
+	board[rt][ft-1] = board[rf][BOARD_RGHT-1]; board[rf][BOARD_RGHT-1] = EmptySquare;
+	break;
+      case WhiteQueenSideCastle: case WhiteQueenSideCastleWild: case BlackQueenSideCastle: case BlackQueenSideCastleWild:
+	board[rt][ft+1] = board[rf][BOARD_LEFT]; board[rf][BOARD_LEFT] = EmptySquare;
+	break;
+      case WhiteHSideCastleFR: case BlackHSideCastleFR: // King captures own Rook
+      case WhiteASideCastleFR: case BlackASideCastleFR:
+	i = (kind == WhiteHSideCastleFR || kind == BlackHSideCastleFR);
+	board[rf][ff] = board[rt][ft] = EmptySquare;
+	board[rf][i ? BOARD_RGHT-3 : BOARD_LEFT+3] = black ? BlackRook : WhiteRook;
+	board[rf][i ? BOARD_RGHT-2 : BOARD_LEFT+2] = piece;
+	return;
+      case WhiteCapturesEnPassant: case BlackCapturesEnPassant:
+	board[rf][ft] = EmptySquare;
+	break;
+      case WhitePromotion: case BlackPromotion:
+	piece = CharToPiece(black ? ToLower(promo) : promo);
+	break;
+      default:
+	if((piece == WhitePawn || piece == BlackPawn) && (rt - rf == 2 || rf - rt == 2) && gameInfo.variant != VariantXiangqi)
+	    board[EP_STATUS] = ft;
+    }
+    board[rf][ff] = EmptySquare;
+    board[rt][ft] = piece;
+}
+
+static long long
+Perft (Board board, int ply, int depth)
+{
+    MoveList *l = &lists[ply];
+    long long nodes = 0;
+    int i, n;
+    Board copy;
+
+    l->nr = 0;
+    GenLegal(board, PosFlags(ply), Collect, (VOIDSTAR) l, EmptySquare);
+    if(depth == 1) return l->nr; // bulk counting
+    for(i=0, n=0; i<l->nr; i++) {
+	ChessMove kind = l->move[i].kind;
+	if(kind == WhitePromotion || kind == BlackPromotion) { // the choices are consecutive entries of the same move
+	    if(i && l->move[i-1].kind == kind && l->move[i-1].rf == l->move[i].rf && l->move[i-1].ff == l->move[i].ff
+		 && l->move[i-1].rt == l->move[i].rt && l->move[i-1].ft == l->move[i].ft) n++; else n = 0;
+	}
+	CopyBoard(copy, board);
+	MakeMove(copy, kind, l->move[i].rf, l->move[i].ff, l->move[i].rt, l->move[i].ft, vi->promotions[n]);
+	nodes += Perft(copy, ply+1, depth-1);
+    }
+    return nodes;
+}
+
+static double
+Seconds ()
+{
+    return clock() / (double) CLOCKS_PER_SEC;
+}
+
+static void
+Count (Board board, int flags, ChessMove kind, int rf, int ff, int rt, int ft, VOIDSTAR closure)
+{
+    (*(int *) closure)++;
+}
+
+static void
+TimeCalls (Board board, int ply)
+{   // average time per call of the individual move-generator functions
+    int i, n, reps = 20000, flags = PosFlags(ply);
+    double t[4];
+
+    t[0] = Seconds();
+    for(i=0; i<reps; i++) n = 0, GenPseudoLegal(board, flags, Count, (VOIDSTAR) &n, EmptySquare);
+    t[1] = Seconds();
+    for(i=0; i<reps; i++) n = 0, GenLegal(board, flags, Count, (VOIDSTAR) &n, EmptySquare);
+    t[2] = Seconds();
+    for(i=0; i<reps; i++) CheckTest(board, flags, -1, -1, -1, -1, FALSE);
+    t[3] = Seconds();
+    printf("  usec/call: GenPseudoLegal %.2f  GenLegal %.2f  CheckTest %.2f", 1e6*(t[1]-t[0])/reps, 1e6*(t[2]-t[1])/reps, 1e6*(t[3]-t[2])/reps);
+    t[0] = Seconds();
+    for(i=0; i<reps; i++) MateTest(board, flags);
+    printf("  MateTest %.2f\n", 1e6*(Seconds()-t[0])/reps);
+}
+
+static int
+RunPosition (char *variant, char *fen, long long *reference, int maxDepth, int quiet)
+{
+    Board board;
+    int btm, depth, errors = 0;
+
+    if(!(vi = SetVariant(variant))) { fprintf(stderr, "perft: unsupported variant %s\n", variant); return 1; }
+    if(!ReadFEN(board, &btm, fen)) { fprintf(stderr, "perft: bad FEN %s\n", fen); return 1; }
+    CopyBoard(initialPosition, board);
+    printf("%s %s\n", variant, fen);
+    for(depth=1; depth<=maxDepth && reference[depth-1]; depth++) {
+	double t = Seconds(), dt;
+	long long nodes = Perft(board, btm, depth);
+	dt = Seconds() - t;
+	printf("  %2d %12lld %12.0f nps%s\n", depth, nodes, dt > 0 ? nodes/dt : 0.,
+		nodes == reference[depth-1] ? "" : "  MISMATCH");
+	if(nodes != reference[depth-1]) printf("     expected %12lld\n", reference[depth-1]), errors++;
+    }
+    if(!quiet) TimeCalls(board, btm);
+    return errors;
+}
+
+static int
+RunFile (char *name, char *variant, int maxDepth, int quiet)
+{   // perft-suite format: FEN ;D1 n1 ;D2 n2 ...
+    FILE *f = fopen(name, "r");
+    char line[MSG_SIZ], *p;
+    int errors = 0;
+
+    if(f == NULL) { perror(name); return 1; }
+    while(fgets(line, MSG_SIZ, f)) {
+	long long reference[MAX_DEPTH+1];
+	int d;
+	if(!(p = strchr(line, ';'))) continue;
+	*p++ = NULLCHAR;
+	memset(reference, 0, sizeof(reference));
+	while(sscanf(p, "D%d", &d) == 1 || sscanf(p, " D%d", &d) == 1) {
+	    if(d >= 1 && d <= MAX_DEPTH) sscanf(strchr(p, 'D') + 1, "%*d %lld", &reference[d-1]);
+	    if(!(p = strchr(p, ';'))) break;
+	    p++;
+	}
+	errors += RunPosition(variant, line, reference, maxDepth, quiet);
+    }
+    fclose(f);
+    return errors;
+}
+
+int
+main (int argc, char **argv)
+{
+    char *variant = NULL, *file = NULL;
+    int i, maxDepth = 4, quiet = 0, errors = 0;
+    Position *p;
+
+    debugFP = stderr;
+    boards = (Board *) calloc(2, sizeof(Board));
+    for(i=1; i<argc; i++) {
+	if(!strcmp(argv[i], "-d") && i+1 < argc) maxDepth = atoi(argv[++i]); else
+	if(!strcmp(argv[i], "-v") && i+1 < argc) variant = argv[++i]; else
+	if(!strcmp(argv[i], "-f") && i+1 < argc) file = argv[++i]; else
+	if(!strcmp(argv[i], "-q")) quiet = 1; else {
+	    fprintf(stderr, "usage: perft [-d maxDepth] [-v variant] [-f file] [-q]\n");
+	    return 1;
+	}
+    }
+    if(maxDepth > MAX_DEPTH) maxDepth = MAX_DEPTH;
+    if(file) errors = RunFile(file, variant ? variant : "normal", maxDepth, quiet);
+    else for(p = positions; p->variant; p++)
+	if(!variant || !strcmp(variant, p->variant)) errors += RunPosition(p->variant, p->fen, p->nodes, maxDepth, quiet);
+    if(errors) printf("%d mismatches\n", errors);
+    return errors != 0;
+}
@@ -0,0 +1,256 @@
+/*
+ * pgnbench.c -- measure how fast the back-end reads, lists, searches and writes PGN
+ *
+ * Copyright 2026 Free Software Foundation, Inc.
+ *
+ * ------------------------------------------------------------------------
+ *
+ * GNU XBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * GNU XBoard is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.  *
+ *
+ *------------------------------------------------------------------------
+ ** See the file ChangeLog for a revision history.  */
+
+/* Runs the back-end without a GUI (see nofrontend.c) over a PGN file, and times
+   the parser.c tokenizer, GameListBuild, LoadGame, SaveGamePGN and a position search
+   with GameContainsPosition in each search mode. Without a file it first writes a
+   corpus of random games. Reports games, moves and bytes per second, and the peak
+   memory use of the process.
+
+   usage: pgnbench [-n games] [-s seed] [-k] [file.pgn]
+*/
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#if HAVE_STRING_H
+# include <string.h>
+#else /* not HAVE_STRING_H */
+# include <strings.h>
+#endif /* not HAVE_STRING_H */
+#if HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "common.h"
+#include "frontend.h"
+#include "backend.h"
+#include "moves.h"
+#include "parser.h"
+
+#define CORPUS  "pgnbench.pgn"
+#define SCRATCH "pgnbench.out"
+#define MAX_GEN 512
+
+// not in backend.h
+int SaveGamePGN P((FILE *f));
+void MakeMove P((int fromX, int fromY, int toX, int toY, int promoChar));
+int PosFlags P((int index));
+
+typedef struct {
+    int nr;
+    struct { ChessMove kind; int rf, ff, rt, ft; } move[MAX_GEN];
+} MoveList;
+
+static MoveList legal;
+
+static void
+Collect (Board board, int flags, ChessMove kind, int rf, int ff, int rt, int ft, VOIDSTAR closure)
+{
+    MoveList *l = (MoveList *) closure;
+    if(l->nr >= MAX_GEN) return;
+    l->move[l->nr].kind = kind;
+    l->move[l->nr].rf = rf; l->move[l->nr].ff = ff; l->move[l->nr].rt = rt; l->move[l->nr].ft = ft;
+    l->nr++;
+}
+
+static void
+RandomGame (int nr)
+{   // play random legal moves from the start position, until mate, stalemate or the ply limit
+    char buf[MSG_SIZ];
+    int plies = 40 + random() % 120;
+
+    Reset(FALSE, TRUE);
+    while(forwardMostMove < plies) {
+	int n, promo;
+	legal.nr = 0;
+	GenLegal(boards[forwardMostMove], PosFlags(forwardMostMove), Collect, (VOIDSTAR) &legal, EmptySquare);
+	if(legal.nr == 0) break;
+	n = random() % legal.nr;
+	promo = (legal.move[n].kind == WhitePromotion || legal.move[n].kind == BlackPromotion ? "qrbn"[random() & 3] : NULLCHAR);
+	MakeMove(legal.move[n].ff, legal.move[n].rf, legal.move[n].ft, legal.move[n].rt, promo);
+	currentMove = forwardMostMove;
+    }
+    switch(MateTest(boards[forwardMostMove], PosFlags(forwardMostMove))) {
+      case MT_CHECKMATE:
+	gameInfo.result = WhiteOnMove(forwardMostMove) ? BlackWins : WhiteWins; break;
+      case MT_STALEMATE:
+	gameInfo.result = GameIsDrawn; break;
+      default:
+	gameInfo.result = GameUnfinished;
+    }
+    snprintf(buf, MSG_SIZ, "Player %ld", random() % 100); ASSIGN(gameInfo.white, buf);
+    snprintf(buf, MSG_SIZ, "Player %ld", random() % 100); ASSIGN(gameInfo.black, buf);
+    ASSIGN(gameInfo.event, "pgnbench");
+    snprintf(buf, MSG_SIZ, "%d", nr); ASSIGN(gameInfo.round, buf);
+    gameInfo.whiteRating = 1800 + random() % 800;
+    gameInfo.blackRating = 1800 + random() % 800;
+}
+
+static int
+MakeCorpus (char *name, int games)
+{
+    FILE *f;
+    int i;
+
+    if((f = fopen(name, "w")) == NULL) return FALSE;
+    fclose(f);
+    for(i=1; i<=games; i++) {
+	RandomGame(i);
+	if((f = fopen(name, "a")) == NULL) return FALSE;
+	SaveGamePGN(f);
+    }
+    return TRUE;
+}
+
+static double
+Seconds ()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+static void
+Report (char *what, double t, long games, long moves, long bytes)
+{
+    if(t <= 0) t = 1e-6;
+    printf("%-26s %8.3f s %10.0f games/s", what, t, games/t);
+    if(moves) printf(" %11.0f moves/s", moves/t);
+    if(bytes) printf(" %7.2f MB/s", bytes/t/1e6);
+    printf("\n");
+}
+
+int
+main (int argc, char **argv)
+{
+    char *name = NULL;
+    int i, games = 500, keep = FALSE, synthetic = FALSE, nrGames, mode;
+    long tokens = 0, moves = 0, bytes;
+    unsigned seed = 1;
+    double t;
+    FILE *f;
+    struct stat st;
+    struct rusage ru;
+    ListGame *lg;
+
+    for(i=1; i<argc; i++) {
+	if(!strcmp(argv[i], "-n") && i+1 < argc) games = atoi(argv[++i]); else
+	if(!strcmp(argv[i], "-s") && i+1 < argc) seed = atoi(argv[++i]); else
+	if(!strcmp(argv[i], "-k")) keep = TRUE; else
+	if(argv[i][0] != '-' && !name) name = argv[i]; else {
+	    fprintf(stderr, "usage: pgnbench [-n games] [-s seed] [-k] [file.pgn]\n");
+	    return 1;
+	}
+    }
+
+    // the options the back-end needs; all others stay off
+    debugFP = stderr;
+    appData.variant = "normal";
+    appData.NrFiles = appData.NrRanks = appData.holdingsSize = -1;
+    appData.testLegality = TRUE;
+    appData.noChessProgram = TRUE;
+    appData.timeControl = "5"; appData.movesPerSession = 40; appData.timeIncrement = -1;
+    appData.searchTime = appData.pgnName[0] = appData.pgnName[1] = appData.polyglotBook = appData.loadGameFile = appData.loadPositionFile = "";
+    appData.saveGameFile = appData.savePositionFile = appData.featureDefaults = "";
+    for(i=0; i<ENGINES; i++) { // the engine set-up edits these in place
+	appData.chessProgram[i] = strdup(""); appData.host[i] = strdup("localhost"); appData.directory[i] = strdup(".");
+	appData.engInitString[i] = appData.computerString[i] = appData.engOptions[i] = appData.fenOverride[i] = "";
+	appData.protocolVersion[i] = 2; appData.timeOdds[i] = 1;
+    }
+    appData.stretch = 1;
+    InitBackEnd1();
+    srandom(seed);
+
+    if(!name) {
+	name = CORPUS; synthetic = TRUE;
+	t = Seconds();
+	if(!MakeCorpus(name, games)) { perror(name); return 1; }
+	printf("wrote %d random games to %s in %.3f s\n", games, name, Seconds() - t);
+    }
+    if(stat(name, &st) || (f = fopen(name, "rb")) == NULL) { perror(name); return 1; }
+    bytes = st.st_size;
+
+    // tokenizer alone: moves are resolved against the start position, so only lexing speed counts
+    Reset(FALSE, TRUE);
+    yynewfile(f);
+    yyboardindex = 0;
+    t = Seconds();
+    while(Myylex() != EndOfFile) tokens++;
+    t = Seconds() - t;
+    printf("%-26s %8.3f s %10.0f tokens/s %7.2f MB/s\n", "tokenizer", t, tokens/(t > 0 ? t : 1e-6), bytes/(t > 0 ? t : 1e-6)/1e6);
+    rewind(f);
+
+    t = Seconds();
+    if(GameListBuild(f)) { fprintf(stderr, "pgnbench: cannot list %s\n", name); return 1; }
+    t = Seconds() - t;
+    nrGames = 0;
+    for(lg = (ListGame *) gameList.head; lg->node.succ; lg = (ListGame *) lg->node.succ) nrGames++;
+    Report("GameListBuild", t, nrGames, 0, bytes);
+
+    t = Seconds();
+    for(i=1; i<=nrGames; i++) {
+	if(!LoadGame(f, i, "", TRUE)) continue;
+	moves += forwardMostMove - backwardMostMove;
+    }
+    t = Seconds() - t;
+    Report("LoadGame", t, nrGames, moves, bytes);
+
+    t = Seconds();
+    for(i=1; i<=nrGames; i++) {
+	FILE *g;
+	if(!LoadGame(f, i, "", TRUE)) continue;
+	if((g = fopen(SCRATCH, i == 1 ? "w" : "a")) == NULL) { perror(SCRATCH); return 1; }
+	SaveGamePGN(g);
+    }
+    t = Seconds() - t;
+    stat(SCRATCH, &st);
+    Report("LoadGame + SaveGamePGN", t, nrGames, moves, st.st_size);
+    unlink(SCRATCH);
+
+    // search for the position after 10 moves of the middle game of the list
+    LoadGame(f, (nrGames + 1)/2, "", TRUE);
+    currentMove = forwardMostMove < 20 ? forwardMostMove : 20;
+    for(mode=1; mode<=6; mode++) {
+	char buf[MSG_SIZ];
+	int found = 0;
+	appData.searchMode = mode;
+	InitSearch();
+	t = Seconds();
+	for(lg = (ListGame *) gameList.head; lg->node.succ; lg = (ListGame *) lg->node.succ)
+	    found += (GameContainsPosition(f, lg) >= 0);
+	t = Seconds() - t;
+	snprintf(buf, MSG_SIZ, "search mode %d (%d found)", mode, found);
+	Report(buf, t, nrGames, 0, 0);
+    }
+
+    fclose(f);
+    if(synthetic && !keep) unlink(name);
+    getrusage(RUSAGE_SELF, &ru);
+    printf("peak memory %ld KB\n", (long) ru.ru_maxrss);
+    return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * pgnmerge.c -- merge the per-instance PGN files of a match or tourney
+ *
+ * Copyright 2026 Free Software Foundation, Inc.
+ *
+ * ------------------------------------------------------------------------
+ *
+ * GNU XBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * GNU XBoard is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.  *
+ *
+ *------------------------------------------------------------------------
+ ** See the file ChangeLog for a revision history.  */
+
+/* With -saveShards every XBoard instance of a match or tourney appends its games to a file
+   of its own, with a [Number] tag. This tool reads such files, and writes all games to one
+   PGN file ordered by that number. Games without a number come last, in the order read.
+
+   usage: pgnmerge [-o output] file ...
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+typedef struct {
+    char *text;
+    size_t len;
+    int number, seq;
+} Game;
+
+static Game *games;
+static int nrOfGames, maxGames;
+
+static char *
+ReadFile (char *name, size_t *len)
+{
+    FILE *f = fopen(name, "rb");
+    char *buf = NULL;
+    size_t size = 0, n;
+
+    *len = 0;
+    if(f == NULL) return NULL;
+    do {
+	if(*len + 65536 > size) buf = realloc(buf, size = 2*size + 65536);
+	if(buf == NULL) break;
+	n = fread(buf + *len, 1, size - *len, f);
+	*len += n;
+    } while(n > 0);
+    fclose(f);
+    return buf;
+}
+
+static void
+AddGame (char *text, size_t len)
+{
+    char *p, *end = text + len;
+    Game *g;
+
+    if(nrOfGames >= maxGames) {
+	games = realloc(games, (maxGames = 2*maxGames + 1024) * sizeof(Game));
+	if(games == NULL) { fprintf(stderr, "pgnmerge: out of memory\n"); exit(1); }
+    }
+    g = &games[nrOfGames];
+    g->text = text; g->len = len; g->seq = nrOfGames++; g->number = INT_MAX;
+    for(p = text; p < end && *p == '['; p++) { // scan the tags for Number
+	if(!strncmp(p, "[Number \"", 9)) g->number = atoi(p + 9);
+	while(p < end && *p != '\n') p++;
+    }
+}
+
+static void
+SplitGames (char *buf, size_t len)
+{   // a game starts at a tag line that follows a line of move text (or the start of the file);
+    // lines inside a {comment} that spans several lines are move text, whatever they start with
+    char *p = buf, *end = buf + len, *start = NULL;
+    int inMoves = 1, inComment = 0;
+
+    while(p < end) {
+	char *line = p;
+	if(!inComment && *line == '[') {
+	    if(inMoves) {
+		if(start) AddGame(start, line - start);
+		start = line;
+	    }
+	    inMoves = 0;
+	    while(p < end && *p != '\n') p++; // tag values can contain braces
+	} else {
+	    if(inComment || (*line != '\n' && *line != '\r')) inMoves = 1;
+	    for(; p < end && *p != '\n'; p++) { // track comments
+		if(inComment) { if(*p == '}') inComment = 0; }
+		else if(*p == '{') inComment = 1;
+		else if(*p == ';') { while(p < end && *p != '\n') p++; break; } // rest of line is comment
+	    }
+	}
+	if(p < end) p++;
+    }
+    if(start) AddGame(start, end - start);
+}
+
+static int
+CompareGames (const void *a, const void *b)
+{
+    const Game *g = a, *h = b;
+    if(g->number != h->number) return g->number < h->number ? -1 : 1;
+    return g->seq - h->seq;
+}
+
+int
+main (int argc, char **argv)
+{
+    FILE *out = stdout;
+    int i;
+
+    if(argc > 2 && !strcmp(argv[1], "-o")) {
+	if((out = fopen(argv[2], "w")) == NULL) { perror(argv[2]); return 1; }
+	argv += 2; argc -= 2;
+    }
+    if(argc < 2) {
+	fprintf(stderr, "usage: pgnmerge [-o output] file ...\n");
+	return 1;
+    }
+    for(i=1; i<argc; i++) {
+	size_t len;
+	char *buf = ReadFile(argv[i], &len);
+	if(buf == NULL) { perror(argv[i]); return 1; }
+	SplitGames(buf, len);
+    }
+    qsort(games, nrOfGames, sizeof(Game), CompareGames);
+    for(i=0; i<nrOfGames; i++) {
+	Game *g = &games[i];
+	size_t len = g->len;
+	while(len && (g->text[len-1] == '\n' || g->text[len-1] == '\r')) len--;
+	fwrite(g->text, 1, len, out);
+	fputs("\n\n", out); // games are separated by an empty line, as XBoard saves them
+    }
+    if(fclose(out)) { perror("pgnmerge"); return 1; }
+    return 0;
+}
@@ -1,5 +1,5 @@
 /*
- * usounds.c -- sound handling for XBoard (through external player)
+ * usounds.c -- sound handling for XBoard (in-process, or through external player)
  *
  * Copyright 1991 by Digital Equipment Corporation, Maynard,
  * Massachusetts.
@@ -72,9 +72,246 @@ extern char *getenv();
 # include <unistd.h>
 #endif
 
+#if HAVE_FCNTL_H
+# include <fcntl.h>
+#else /* not HAVE_FCNTL_H */
+# if HAVE_SYS_FCNTL_H
+#  include <sys/fcntl.h>
+# endif /* HAVE_SYS_FCNTL_H */
+#endif /* not HAVE_FCNTL_H */
+
+#if HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
+
+#if HAVE_SYS_SOUNDCARD_H
+# include <sys/ioctl.h>
+# include <sys/soundcard.h>
+#endif
+
+#if HAVE_PULSE
+# include <pulse/simple.h>
+#endif
+
 #include "common.h"
 #include "frontend.h"
 
+/* In-process playback: the WAV files are decoded once, converted to 16-bit
+   stereo at a fixed rate, and kept in memory. Playing a sound just adds it
+   to the list of active voices; a separate thread mixes these and writes
+   the result to the audio device (or a file, or nowhere). When no device
+   can be used, or a file cannot be decoded, the soundProgram is run. */
+
+#define RATE 44100
+#define BLOCK 1024       /* frames mixed at a time (23 msec) */
+#define MAX_VOICES 8
+#define MAX_SAMPLES 64
+
+typedef struct {
+    char *name;
+    short *data;         /* interleaved stereo; NULL if file could not be decoded */
+    int frames;
+} Sample;
+
+enum { OUT_PROGRAM, OUT_NULL, OUT_FILE, OUT_OSS, OUT_PULSE };
+
+static Sample samples[MAX_SAMPLES];
+static int nrOfSamples, outputType = -1;
+static FILE *audioFile;
+#if HAVE_SYS_SOUNDCARD_H
+static int dsp = -1;
+#endif
+#if HAVE_PULSE
+static pa_simple *pulse;
+#endif
+
+static int
+GetLE (unsigned char *p, int n)
+{
+    int r = 0;
+    while(n--) r = r << 8 | p[n];
+    return r;
+}
+
+static Sample *
+LoadSample (char *name)
+{   // decode PCM WAV file into a new cache entry
+    Sample *s;
+    FILE *f;
+    unsigned char *buf = NULL, *p, *data = NULL;
+    int len = 0, channels = 0, rate = 0, bits = 0, dataLen = 0, frames, i, j;
+
+    if(nrOfSamples >= MAX_SAMPLES) return NULL;
+    s = &samples[nrOfSamples++];
+    s->name = strdup(name); s->data = NULL; s->frames = 0;
+    if((f = fopen(name, "rb"))) {
+	fseek(f, 0, SEEK_END); len = ftell(f); rewind(f);
+	if(len > 12 && (buf = malloc(len))) len = fread(buf, 1, len, f); else len = 0;
+	fclose(f);
+    }
+    if(len < 12 || memcmp(buf, "RIFF", 4) || memcmp(buf+8, "WAVE", 4)) { free(buf); return s; }
+    for(p = buf + 12; p + 8 <= buf + len; p += 8 + (GetLE(p+4, 4) + 1 & ~1)) { // walk the chunks
+	int size = GetLE(p+4, 4);
+	if(size < 0 || p + 8 + size > buf + len) size = buf + len - p - 8;
+	if(!memcmp(p, "fmt ", 4) && size >= 16) {
+	    if(GetLE(p+8, 2) != 1) break; // only plain PCM
+	    channels = GetLE(p+10, 2); rate = GetLE(p+12, 4); bits = GetLE(p+22, 2);
+	} else if(!memcmp(p, "data", 4)) { data = p + 8; dataLen = size; break; }
+    }
+    if(data && channels >= 1 && channels <= 2 && rate > 0 && (bits == 8 || bits == 16)) {
+	int step = channels * bits/8, in = dataLen / step;
+	frames = (int) ((double) in * RATE / rate);
+	if(frames > 0 && (s->data = malloc(2 * frames * sizeof(short)))) {
+	    for(i=0; i<frames; i++) { // resample by picking nearest frame
+		unsigned char *q = data + (int) ((double) i * rate / RATE) * step;
+		for(j=0; j<2; j++) {
+		    unsigned char *c = q + (j < channels ? j : 0) * bits/8;
+		    s->data[2*i+j] = (bits == 8 ? (*c - 128) << 8 : (short) GetLE(c, 2));
+		}
+	    }
+	    s->frames = frames;
+	}
+    }
+    free(buf);
+    return s;
+}
+
+static Sample *
+FindSample (char *name)
+{
+    int i;
+    for(i=0; i<nrOfSamples; i++) if(!strcmp(samples[i].name, name)) return &samples[i];
+    return LoadSample(name);
+}
+
+static int
+WriteAudio (short *buf, int frames)
+{
+    switch(outputType) {
+      case OUT_FILE:
+	fwrite(buf, 2*sizeof(short), frames, audioFile);
+	fflush(audioFile);
+      case OUT_NULL: // pace as if a device were consuming the samples
+	usleep(frames * 1000000LL / RATE);
+	return TRUE;
+#if HAVE_SYS_SOUNDCARD_H
+      case OUT_OSS:
+	return write(dsp, buf, 2*sizeof(short)*frames) > 0;
+#endif
+#if HAVE_PULSE
+      case OUT_PULSE:
+	return pa_simple_write(pulse, buf, 2*sizeof(short)*frames, NULL) >= 0;
+#endif
+    }
+    return FALSE;
+}
+
+#if HAVE_PTHREAD_H
+static pthread_mutex_t mixLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mixWake = PTHREAD_COND_INITIALIZER;
+static struct { Sample *s; int pos; } voice[MAX_VOICES];
+static int nrOfVoices, deviceDied; // guarded by mixLock
+
+static void *
+MixerThread (void *arg)
+{
+    static int mix[2*BLOCK];
+    static short out[2*BLOCK];
+    int i, j, n;
+
+    for(;;) {
+	pthread_mutex_lock(&mixLock);
+	while(nrOfVoices == 0) pthread_cond_wait(&mixWake, &mixLock);
+	memset(mix, 0, sizeof(mix));
+	for(i=0; i<nrOfVoices; i++) {
+	    short *d = voice[i].s->data + 2*voice[i].pos;
+	    n = voice[i].s->frames - voice[i].pos;
+	    if(n > BLOCK) n = BLOCK;
+	    for(j=0; j<2*n; j++) mix[j] += d[j];
+	    if((voice[i].pos += n) >= voice[i].s->frames) voice[i--] = voice[--nrOfVoices]; // finished
+	}
+	pthread_mutex_unlock(&mixLock);
+	for(j=0; j<2*BLOCK; j++) out[j] = (mix[j] > 32767 ? 32767 : mix[j] < -32768 ? -32768 : mix[j]);
+	if(!WriteAudio(out, BLOCK)) { // device died; use program from now on
+	    pthread_mutex_lock(&mixLock);
+	    deviceDied = TRUE; nrOfVoices = 0;
+	    pthread_mutex_unlock(&mixLock);
+	    break;
+	}
+    }
+    return NULL;
+}
+
+static int
+StartVoice (Sample *s)
+{   // returns FALSE when the mixer thread is gone, so the sound must be played otherwise
+    int ok;
+    pthread_mutex_lock(&mixLock);
+    ok = !deviceDied;
+    if(ok && nrOfVoices < MAX_VOICES) voice[nrOfVoices].s = s, voice[nrOfVoices++].pos = 0;
+    pthread_cond_signal(&mixWake);
+    pthread_mutex_unlock(&mixLock);
+    return ok;
+}
+#endif
+
+static void
+OpenSoundOutput ()
+{   // select the output according to the -soundDevice option; fall back on soundProgram
+    char *dev = appData.soundDevice ? appData.soundDevice : "";
+#if HAVE_PTHREAD_H
+    pthread_t thread;
+
+    outputType = OUT_PROGRAM;
+    if(!strcmp(dev, "null")) outputType = OUT_NULL; else
+    if(!strncmp(dev, "file:", 5)) {
+	if((audioFile = fopen(dev + 5, "ab"))) outputType = OUT_FILE;
+    } else {
+#if HAVE_PULSE
+	if(!strcmp(dev, "auto") || !strcmp(dev, "pulse")) {
+	    pa_sample_spec spec;
+	    spec.format = PA_SAMPLE_S16LE; spec.rate = RATE; spec.channels = 2;
+	    if((pulse = pa_simple_new(NULL, "XBoard", PA_STREAM_PLAYBACK, NULL, "sounds", &spec, NULL, NULL, NULL)))
+		outputType = OUT_PULSE;
+	}
+#endif
+#if HAVE_SYS_SOUNDCARD_H
+	if(outputType == OUT_PROGRAM && (!strcmp(dev, "auto") || !strncmp(dev, "oss", 3))) {
+	    int format = AFMT_S16_LE, channels = 2, rate = RATE;
+	    if((dsp = open(dev[3] == ':' ? dev + 4 : "/dev/dsp", O_WRONLY | O_NONBLOCK)) >= 0) {
+		fcntl(dsp, F_SETFL, 0); // only the open should not block when device is busy
+		if(ioctl(dsp, SNDCTL_DSP_SETFMT, &format) < 0 || format != AFMT_S16_LE ||
+		   ioctl(dsp, SNDCTL_DSP_CHANNELS, &channels) < 0 || channels != 2 ||
+		   ioctl(dsp, SNDCTL_DSP_SPEED, &rate) < 0 || rate != RATE) close(dsp), dsp = -1;
+		else outputType = OUT_OSS;
+	    }
+	}
+#endif
+    }
+    if(outputType != OUT_PROGRAM && pthread_create(&thread, NULL, MixerThread, NULL)) outputType = OUT_PROGRAM;
+#else
+    outputType = OUT_PROGRAM;
+#endif
+}
+
+static char *
+SoundPath (char *buf, int size, char *name)
+{
+    char *prefix = "", *sep = "";
+    if(!strchr(name, '/')) { prefix = appData.soundDirectory; sep = "/"; }
+    snprintf(buf, size, "%s%s%s", prefix, sep, name);
+    return buf;
+}
+
+void
+PreloadSounds ()
+{   // open sound output and decode all configured sound files
+    char **name, buf[MSG_SIZ];
+    if(outputType < 0) OpenSoundOutput();
+    if(outputType == OUT_PROGRAM) return;
+    for(name = &appData.soundShout; name <= &appData.soundIcsUnfinished; name++) // relies on order in AppData
+	if(*name && **name && strcmp(*name, "$")) FindSample(SoundPath(buf, MSG_SIZ, *name));
+}
 
 int
 PlaySoundFile (char *name)
@@ -84,11 +321,17 @@ PlaySoundFile (char *name)
   } else if (strcmp(name, "$") == 0) {
     putc(BELLCHAR, stderr);
   } else {
-    char buf[2048];
-    char *prefix = "", *sep = "";
+    char buf[2048], path[MSG_SIZ];
+    SoundPath(path, MSG_SIZ, name);
+#if HAVE_PTHREAD_H
+    if(outputType < 0) PreloadSounds();
+    if(outputType != OUT_PROGRAM) {
+	Sample *s = FindSample(path);
+	if(s && s->data && StartVoice(s)) return 1;
+    }
+#endif
     if(appData.soundProgram[0] == NULLCHAR) return 1;
-    if(!strchr(name, '/')) { prefix = appData.soundDirectory; sep = "/"; }
-    snprintf(buf, sizeof(buf), "%s '%s%s%s' &", appData.soundProgram, prefix, sep, name);
+    snprintf(buf, sizeof(buf), "%s '%s' &", appData.soundProgram, path);
     system(buf);
   }
   return 1;
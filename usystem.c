@@ -51,6 +51,10 @@
 
 #include "config.h"
 
+#if HAVE_FOPENCOOKIE
+# define _GNU_SOURCE 1 /* for fopencookie() */
+#endif
+
 #include <stdio.h>
 #include <ctype.h>
 #include <signal.h>
@@ -100,6 +104,10 @@ extern char *getenv();
 # include <sys/systeminfo.h>
 #endif /* HAVE_SYS_SYSTEMINFO_H */
 
+#if HAVE_SYS_INOTIFY_H
+# include <sys/inotify.h>
+#endif /* HAVE_SYS_INOTIFY_H */
+
 #if TIME_WITH_SYS_TIME
 # include <sys/time.h>
 # include <time.h>
@@ -119,6 +127,16 @@ extern char *getenv();
 # include <sys/wait.h>
 #endif
 
+#if HAVE_PTHREAD_H && (HAVE_FOPENCOOKIE || HAVE_FUNOPEN)
+# include <pthread.h>
+# define THREADED_LOG 1
+#endif
+
+#if HAVE_ZLIB_H && HAVE_LIBZ && (HAVE_FOPENCOOKIE || HAVE_FUNOPEN)
+# include <zlib.h>
+# define GZ_FILES 1
+#endif
+
 #if HAVE_DIRENT_H
 # include <dirent.h>
 # define NAMLEN(dirent) strlen((dirent)->d_name)
@@ -514,6 +532,11 @@ DestroyChildProcess (ProcRef pr, int signalType)
 {
     ChildProc *cp = (ChildProc *) pr;
 
+    if (cp->kind == CPWatch) { // file watch: just release the inotify descriptor
+	cp->kind = CPNone;
+	close(cp->fdFrom);
+	return;
+    }
     if (cp->kind != CPReal) return;
     cp->kind = CPNone;
     if (signalType & 1) {
@@ -643,6 +666,34 @@ OpenLoopback (ProcRef *pr)
     return 0;
 }
 
+int
+OpenFileWatch (char *name, ProcRef *pr)
+{   // input source that becomes readable whenever the given file is modified
+#if HAVE_SYS_INOTIFY_H
+    int fd, err;
+    ChildProc *cp;
+
+    fd = inotify_init();
+    if (fd < 0) return errno;
+    if (inotify_add_watch(fd, name, IN_MODIFY) < 0) {
+	err = errno;
+	close(fd);
+	return err;
+    }
+
+    cp = (ChildProc *) calloc(1, sizeof(ChildProc));
+    cp->kind = CPWatch;
+    cp->pid = 0;
+    cp->fdFrom = fd;
+    cp->fdTo = -1;
+    *pr = (ProcRef) cp;
+
+    return 0;
+#else
+    return ENOSYS;
+#endif
+}
+
 int
 OpenRcmd (char *host, char *user, char *cmd, ProcRef *pr)
 {
@@ -797,3 +848,406 @@ NotifyFrontendLogin ()
 {
     update_ics_width();
 }
+
+/* The debug file is written by a separate thread: the stream handed out by
+   OpenDebugFile only copies the text into a ring buffer, so that logging all
+   engine traffic does not make the GUI wait for the disk. All output to the
+   stream still passes through the one buffer, so it stays in order. */
+
+#if THREADED_LOG
+
+#define LOG_RING (1 << 20)
+
+typedef struct DebugLog {
+    FILE *f;
+    char *ring;
+    volatile unsigned int head, tail; // only the GUI advances head, only the writer tail
+    volatile int closing, done;
+    pthread_t writer;
+    struct DebugLog *next;
+} DebugLog;
+
+static DebugLog *openLogs;
+
+static void *
+LogWriter (void *arg)
+{
+    DebugLog *log = (DebugLog *) arg;
+    while(1) {
+	int closing = __atomic_load_n(&log->closing, __ATOMIC_ACQUIRE);
+	unsigned int head = __atomic_load_n(&log->head, __ATOMIC_ACQUIRE), tail = log->tail, n, off;
+	if(head == tail) {
+	    fflush(log->f);
+	    if(closing) break;
+	    usleep(5000);
+	    continue;
+	}
+	off = tail % LOG_RING; n = head - tail;
+	if(off + n > LOG_RING) n = LOG_RING - off;
+	fwrite(log->ring + off, 1, n, log->f);
+	__atomic_store_n(&log->tail, tail + n, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+static int
+LogPut (DebugLog *log, const char *buf, int size)
+{
+    int done = 0;
+    if(log->done) return fwrite(buf, 1, size, log->f); // writer already stopped at exit
+    while(done < size) {
+	unsigned int head = log->head, tail = __atomic_load_n(&log->tail, __ATOMIC_ACQUIRE);
+	unsigned int n = LOG_RING - (head - tail), off = head % LOG_RING;
+	if(n == 0) { usleep(1000); continue; } // ring full: rather wait than lose text
+	if(n > size - done) n = size - done;
+	if(off + n > LOG_RING) n = LOG_RING - off;
+	memcpy(log->ring + off, buf + done, n);
+	__atomic_store_n(&log->head, head + n, __ATOMIC_RELEASE);
+	done += n;
+    }
+    return size;
+}
+
+static void
+StopWriter (DebugLog *log)
+{
+    if(log->done) return;
+    __atomic_store_n(&log->closing, 1, __ATOMIC_RELEASE);
+    pthread_join(log->writer, NULL);
+    log->done = 1;
+}
+
+static int
+LogClose (void *cookie)
+{
+    DebugLog *log = (DebugLog *) cookie, **p;
+    StopWriter(log);
+    for(p = &openLogs; *p; p = &(*p)->next) if(*p == log) { *p = log->next; break; }
+    fclose(log->f);
+    free(log->ring);
+    free(log);
+    return 0;
+}
+
+static void
+FlushDebugFiles ()
+{   // at exit: whatever is still in the ring must reach the file
+    DebugLog *log;
+    for(log = openLogs; log; log = log->next) StopWriter(log);
+}
+
+#if HAVE_FOPENCOOKIE
+static ssize_t
+LogWrite (void *cookie, const char *buf, size_t size)
+{
+    return LogPut((DebugLog *) cookie, buf, size);
+}
+#else
+static int
+LogWrite (void *cookie, const char *buf, int size)
+{
+    return LogPut((DebugLog *) cookie, buf, size);
+}
+#endif
+
+#endif /* THREADED_LOG */
+
+FILE *
+OpenDebugFile (char *name)
+{
+    FILE *f = fopen(name, "w");
+#if THREADED_LOG
+    static int registered;
+    DebugLog *log;
+    FILE *g = NULL;
+
+    if(f == NULL) return NULL;
+    if((log = (DebugLog *) calloc(1, sizeof(DebugLog))) && (log->ring = malloc(LOG_RING))) {
+	log->f = f;
+	if(pthread_create(&log->writer, NULL, LogWriter, log) == 0) {
+#if HAVE_FOPENCOOKIE
+	    cookie_io_functions_t io = { NULL, LogWrite, NULL, LogClose };
+	    g = fopencookie(log, "w", io);
+#else
+	    g = funopen(log, NULL, LogWrite, NULL, LogClose);
+#endif
+	    if(g == NULL) StopWriter(log);
+	}
+    }
+    if(g) {
+	log->next = openLogs; openLogs = log;
+	if(!registered) atexit(FlushDebugFiles), registered = 1;
+	setbuf(g, NULL); // every write goes into the ring at once
+	return g;
+    }
+    if(log) free(log->ring), free(log);
+#endif
+    if(f) setbuf(f, NULL);
+    return f;
+}
+
+/* Game files compressed with gzip are read through a stream that inflates them on the fly.
+   Seeking (as loading a game from the game list does) restarts inflation at the nearest seek
+   point before the target, unless the current position is closer to it. Seek points are
+   recorded about every GZ_SPAN bytes of output, either at the start of a gzip member, or on a
+   deflate block boundary (together with the 32KB of output before it, to which later blocks can
+   refer). Text appended to a file named *.gz is collected in memory, and when the stream is
+   closed, compressed into a gzip member of its own that is appended with a single write. */
+
+#if GZ_FILES
+
+#define GZ_WINDOW 32768
+#define GZ_SPAN   (1 << 20)
+
+typedef struct {
+    off_t out;		   /* offset in uncompressed text */
+    off_t in;		   /* offset of first complete byte in compressed file */
+    int bits;		   /* bits of the byte before that still to use, or -1 at start of gzip member */
+    unsigned char *window; /* output preceding it (only when within a member) */
+} GzPoint;
+
+typedef struct {
+    FILE *f;		   /* compressed file, when reading */
+    char *name;		   /* file to append to, when writing */
+    z_stream strm;
+    unsigned char in[16384], window[GZ_WINDOW];
+    int wpos, raw, eof, nPoints, maxPoints;
+    off_t pos;		   /* uncompressed offset of next byte read */
+    GzPoint *point;
+    char *buf;		   /* text collected for writing */
+    size_t len, size;
+} GzFile;
+
+static int
+GzAddPoint (GzFile *gz, int bits)
+{
+    GzPoint *p;
+    if(gz->nPoints >= gz->maxPoints) {
+	p = (GzPoint *) realloc(gz->point, (2*gz->maxPoints + 16) * sizeof(GzPoint));
+	if(p == NULL) return 0;
+	gz->point = p; gz->maxPoints = 2*gz->maxPoints + 16;
+    }
+    p = &gz->point[gz->nPoints];
+    p->out = gz->pos; p->in = ftello(gz->f) - gz->strm.avail_in; p->bits = bits; p->window = NULL;
+    if(bits >= 0) { // save window in order of output
+	if((p->window = malloc(GZ_WINDOW)) == NULL) return 0;
+	memcpy(p->window, gz->window + gz->wpos, GZ_WINDOW - gz->wpos);
+	memcpy(p->window + GZ_WINDOW - gz->wpos, gz->window, gz->wpos);
+    }
+    gz->nPoints++;
+    return 1;
+}
+
+static int
+GzInput (GzFile *gz)
+{   // make sure there is compressed input; 0 at end of file
+    if(gz->strm.avail_in) return 1;
+    gz->strm.avail_in = fread(gz->in, 1, sizeof(gz->in), gz->f);
+    gz->strm.next_in = gz->in;
+    return gz->strm.avail_in > 0;
+}
+
+static ssize_t
+GzInflate (GzFile *gz, char *dest, size_t len)
+{   // produce len bytes of text (fewer at end of file); dest NULL means skip them
+    size_t done = 0;
+    while(done < len && !gz->eof) {
+	unsigned char *start = gz->window + gz->wpos;
+	int ret, have, n = GZ_WINDOW - gz->wpos;
+	if(!GzInput(gz)) { gz->eof = 1; break; } // truncated file: deliver what we have
+	if(n > len - done) n = len - done;
+	gz->strm.next_out = start; gz->strm.avail_out = n;
+	ret = inflate(&gz->strm, Z_BLOCK);
+	if(ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) { errno = EIO; return -1; }
+	have = gz->strm.next_out - start;
+	if(dest) memcpy(dest + done, start, have);
+	done += have; gz->pos += have;
+	if((gz->wpos += have) == GZ_WINDOW) gz->wpos = 0;
+	if(ret == Z_STREAM_END) { // end of gzip member; another one might follow
+	    if(gz->raw) { // after a seek we inflate raw deflate data, and must skip the gzip trailer ourselves
+		int skip = 8;
+		while(skip > 0 && GzInput(gz)) {
+		    n = gz->strm.avail_in < skip ? gz->strm.avail_in : skip;
+		    gz->strm.next_in += n; gz->strm.avail_in -= n; skip -= n;
+		}
+	    }
+	    if(!GzInput(gz) || gz->strm.next_in[0] != 0x1f) { gz->eof = 1; break; } // no more members (maybe padding)
+	    inflateReset2(&gz->strm, 15 + 16); gz->raw = 0;
+	    if(gz->pos >= gz->point[gz->nPoints-1].out + GZ_SPAN) GzAddPoint(gz, -1);
+	} else if((gz->strm.data_type & 128) && !(gz->strm.data_type & 64) && gz->pos >= gz->point[gz->nPoints-1].out + GZ_SPAN)
+	    GzAddPoint(gz, gz->strm.data_type & 7); // on a block boundary, and not after the last block
+    }
+    return done;
+}
+
+static off_t
+GzSeekTo (GzFile *gz, off_t offset, int whence)
+{
+    if(gz->name) { errno = ESPIPE; return -1; } // cannot seek in output
+    if(whence == SEEK_END) { // only known after inflating everything
+	while(!gz->eof) if(GzInflate(gz, NULL, GZ_SPAN) < 0) return -1;
+	offset += gz->pos;
+    } else if(whence == SEEK_CUR) offset += gz->pos;
+    if(offset < 0) { errno = EINVAL; return -1; }
+    if(offset != gz->pos) { // restart at last seek point before target, if we are not closer to it already
+	int i = gz->nPoints;
+	GzPoint *p;
+	while(--i > 0 && gz->point[i].out > offset);
+	p = &gz->point[i];
+	if(offset < gz->pos || p->out > gz->pos) {
+	    if(fseeko(gz->f, p->in - (p->bits > 0), SEEK_SET)) return -1;
+	    gz->strm.avail_in = 0;
+	    if(p->bits < 0) inflateReset2(&gz->strm, 15 + 16), gz->raw = 0; else {
+		inflateReset2(&gz->strm, -15); gz->raw = 1;
+		if(p->bits) {
+		    int c = getc(gz->f);
+		    if(c == EOF) { errno = EIO; return -1; }
+		    inflatePrime(&gz->strm, p->bits, c >> (8 - p->bits));
+		}
+		inflateSetDictionary(&gz->strm, p->window, GZ_WINDOW);
+	    }
+	    gz->pos = p->out; gz->eof = 0;
+	}
+    }
+    if(offset > gz->pos && GzInflate(gz, NULL, offset - gz->pos) < 0) return -1;
+    return gz->pos;
+}
+
+static int
+GzCollect (GzFile *gz, const char *buf, size_t size)
+{
+    if(!gz->name) { errno = EBADF; return -1; }
+    if(gz->len + size > gz->size) {
+	char *p = realloc(gz->buf, 2*(gz->len + size) + 4096);
+	if(p == NULL) return -1;
+	gz->buf = p; gz->size = 2*(gz->len + size) + 4096;
+    }
+    memcpy(gz->buf + gz->len, buf, size);
+    gz->len += size;
+    return size;
+}
+
+static int
+GzAppendMember (GzFile *gz)
+{   // compress the collected text into one gzip member, and append that to the file in one write
+    z_stream s;
+    unsigned char *out;
+    uLong bound;
+    int fd, ok = FALSE;
+
+    if(gz->len == 0) return 0;
+    memset(&s, 0, sizeof(s));
+    if(deflateInit2(&s, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return EOF;
+    bound = deflateBound(&s, gz->len);
+    if((out = malloc(bound))) {
+	s.next_in = (unsigned char *) gz->buf; s.avail_in = gz->len;
+	s.next_out = out; s.avail_out = bound;
+	if(deflate(&s, Z_FINISH) == Z_STREAM_END && (fd = open(gz->name, O_WRONLY | O_APPEND | O_CREAT, 0666)) >= 0) {
+	    ok = (write(fd, out, s.total_out) == s.total_out);
+	    close(fd);
+	}
+	free(out);
+    }
+    deflateEnd(&s);
+    return ok ? 0 : EOF;
+}
+
+static int
+GzClose (void *cookie)
+{
+    GzFile *gz = (GzFile *) cookie;
+    int i, err = 0;
+    if(gz->name) err = GzAppendMember(gz); else {
+	inflateEnd(&gz->strm);
+	fclose(gz->f);
+	for(i=0; i<gz->nPoints; i++) free(gz->point[i].window);
+	free(gz->point);
+    }
+    free(gz->name); free(gz->buf); free(gz);
+    return err;
+}
+
+#if HAVE_FOPENCOOKIE
+static ssize_t
+GzRead (void *cookie, char *buf, size_t size)
+{
+    return GzInflate((GzFile *) cookie, buf, size);
+}
+
+static ssize_t
+GzWrite (void *cookie, const char *buf, size_t size)
+{
+    return GzCollect((GzFile *) cookie, buf, size);
+}
+
+static int
+GzSeek (void *cookie, off64_t *offset, int whence)
+{
+    off_t pos = GzSeekTo((GzFile *) cookie, *offset, whence);
+    if(pos < 0) return -1;
+    *offset = pos;
+    return 0;
+}
+#else
+static int
+GzRead (void *cookie, char *buf, int size)
+{
+    return GzInflate((GzFile *) cookie, buf, size);
+}
+
+static int
+GzWrite (void *cookie, const char *buf, int size)
+{
+    return GzCollect((GzFile *) cookie, buf, size);
+}
+
+static fpos_t
+GzSeek (void *cookie, fpos_t offset, int whence)
+{
+    return GzSeekTo((GzFile *) cookie, offset, whence);
+}
+#endif
+
+static FILE *
+GzOpen (GzFile *gz, char *mode)
+{
+#if HAVE_FOPENCOOKIE
+    cookie_io_functions_t io = { GzRead, GzWrite, GzSeek, GzClose };
+    return fopencookie(gz, mode, io);
+#else
+    return funopen(gz, GzRead, GzWrite, GzSeek, GzClose);
+#endif
+}
+
+#endif /* GZ_FILES */
+
+FILE *
+OpenPGNFile (char *name, char *mode)
+{   // fopen() that makes gzip-compressed game files look like plain ones
+    int n = strlen(name), gzName = (n > 3 && !strcmp(name + n - 3, ".gz"));
+#if GZ_FILES
+    GzFile *gz;
+    FILE *f, *g;
+
+    if(*mode == 'a' && gzName) {
+	if((gz = (GzFile *) calloc(1, sizeof(GzFile))) == NULL) return NULL;
+	gz->name = strdup(name);
+	if(gz->name && (g = GzOpen(gz, "w"))) return g;
+	free(gz->name); free(gz);
+	return NULL;
+    }
+    if(*mode != 'r' || (f = fopen(name, mode)) == NULL) return fopen(name, mode);
+    if(getc(f) != 0x1f || getc(f) != 0x8b) { rewind(f); return f; } // not compressed
+    rewind(f);
+    if((gz = (GzFile *) calloc(1, sizeof(GzFile))) && inflateInit2(&gz->strm, 15 + 16) == Z_OK) {
+	gz->f = f;
+	if(GzAddPoint(gz, -1) && (g = GzOpen(gz, "r"))) return g;
+	inflateEnd(&gz->strm); free(gz->point);
+    }
+    free(gz); fclose(f);
+    return NULL;
+#else
+    if(*mode == 'a' && gzName) { errno = EINVAL; return NULL; } // would otherwise write plain text
+    return fopen(name, mode);
+#endif
+}
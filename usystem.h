@@ -59,6 +59,7 @@ typedef struct {
 #define CPComm 2
 #define CPSock 3
 #define CPLoop 4
+#define CPWatch 5
 typedef int CPKind;
 
 typedef struct {
@@ -930,7 +930,7 @@ SayWhosTurn()
 	SayString("", TRUE); // flush
 }
 
-extern char *commentList[];
+extern char **commentList;
 
 VOID
 SayMachineMove(int evenIfDuplicate)
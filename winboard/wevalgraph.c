@@ -311,7 +311,7 @@ VOID EvalGraphPopDown()
 // support the eval graph, it would be more logical to call it directly from the back-end.
 VOID EvalGraphSet( int first, int last, int current, ChessProgramStats_Move * pvInfo )
 {
-    /* [AS] Danger! For now we rely on the pvInfo parameter being a static variable! */
+    /* [AS] Danger! We keep the pvInfo pointer; HistorySet() passes it again after GrowGameStorage() moved it */
 
     currFirst = first;
     currLast = last;
@@ -90,6 +90,13 @@ void ClearHistoryMemo()
     SendDlgItemMessage( moveHistoryDialog, IDC_MoveHistory, WM_SETTEXT, 0, (LPARAM) "" );
 }
 
+// low-level front-end; remove all text from the given offset on
+void TruncateHistoryMemo( int offset )
+{
+    SendDlgItemMessage( moveHistoryDialog, IDC_MoveHistory, EM_SETSEL, offset, -1 );
+    SendDlgItemMessage( moveHistoryDialog, IDC_MoveHistory, EM_REPLACESEL, (WPARAM) FALSE, (LPARAM) "" );
+}
+
 // low-level front-end, made callable from back-end by passing flags and color numbers
 // its task is to append the given text to the text edit
 // the bold argument says 0 = normal, 1 = bold typeface
@@ -176,6 +176,7 @@ static int loadGameTimerEvent = 0;
 static int analysisTimerEvent = 0;
 static DelayedEventCallback delayedTimerCallback;
 static int delayedTimerEvent = 0;
+static int engineOutputTimerEvent = 0;
 static int buttonCount = 2;
 char *icsTextMenuString;
 char *icsNames;
@@ -759,6 +760,22 @@ void ThawUI()
   DrawMenuBar(hwndMain);
 }
 
+/* [batch annotation] no dialog with an abort button yet: the menus are frozen, as when engines start */
+void AnnotatePopUp()
+{
+  FreezeUI();
+}
+
+void AnnotatePopDown()
+{
+  ThawUI();
+}
+
+int AnnotateDialogUp()
+{
+  return TRUE;
+}
+
 /*static*/ int fromX = -1, fromY = -1, toX, toY; // [HGM] moved upstream, so JAWS can use them
 
 /* JAWS preparation patch (WinBoard for the sight impaired). Define required insertions as empty */
@@ -5657,6 +5674,11 @@ WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
       delayedTimerEvent = 0;
       delayedTimerCallback();
       break;
+    case ENGINE_OUTPUT_TIMER_ID:
+      KillTimer(hwnd, engineOutputTimerEvent);
+      engineOutputTimerEvent = 0;
+      FlushEngineOutput(); /* call into back end */
+      break;
     }
     break;
 
@@ -9040,6 +9062,30 @@ ScheduleDelayedEvent(DelayedEventCallback cb, long millisec)
 				(UINT) millisec, NULL);
 }
 
+FILE *
+OpenDebugFile(char *name)
+{
+  FILE *f = fopen(name, "w");
+  if (f != NULL) setbuf(f, NULL);
+  return f;
+}
+
+FILE *
+OpenPGNFile(char *name, char *mode)
+{ // no compressed game files
+  int n = strlen(name);
+  if (*mode == 'a' && n > 3 && !strcmp(name + n - 3, ".gz")) { errno = EINVAL; return NULL; }
+  return fopen(name, mode);
+}
+
+void
+StartEngineOutputTimer(long millisec)
+{
+  if (engineOutputTimerEvent) return; /* already pending */
+  engineOutputTimerEvent = SetTimer(hwndMain, (UINT) ENGINE_OUTPUT_TIMER_ID,
+				(UINT) millisec, NULL);
+}
+
 DelayedEventCallback
 GetDelayedEvent()
 {
@@ -170,6 +170,7 @@ extern MyFont *font[NUM_SIZES][NUM_FONTS];
 #define ANALYSIS_TIMER_ID     53
 #define MOUSE_TIMER_ID        54
 #define DELAYED_TIMER_ID      55
+#define ENGINE_OUTPUT_TIMER_ID 56
 
 #define SOLID_PIECE           0
 #define OUTLINE_PIECE         1
@@ -1077,7 +1077,7 @@ main (int argc, char **argv)
 
     if (appData.debugMode && appData.nameOfDebugFile && strcmp(appData.nameOfDebugFile, "stderr")) {
 	/* [DM] debug info to file [HGM] make the filename a command-line option, and allow it to remain stderr */
-        if ((debugFP = fopen(appData.nameOfDebugFile, "w")) == NULL)  {
+        if ((debugFP = OpenDebugFile(appData.nameOfDebugFile)) == NULL)  {
            printf(_("Failed to open file '%s'\n"), appData.nameOfDebugFile);
            exit(errno);
         }
@@ -1094,6 +1094,7 @@ main (int argc, char **argv)
     appData.highlightDragging = FALSE;
 #endif
     InitBackEnd1();
+    PreloadSounds();
 
 	gameInfo.variant = StringToVariant(appData.variant);
 	InitPosition(FALSE);
@@ -2226,6 +2227,25 @@ CancelDelayedEvent ()
   }
 }
 
+XtIntervalId engineOutputTimerXID = 0;
+
+void
+EngineOutputTimerCallback (XtPointer arg, XtIntervalId *id)
+{
+    engineOutputTimerXID = 0;
+    FlushEngineOutput();
+}
+
+void
+StartEngineOutputTimer (long millisec)
+{
+    if (engineOutputTimerXID) return; // already pending
+    engineOutputTimerXID =
+      XtAppAddTimeOut(appContext, millisec,
+		      (XtTimerCallbackProc) EngineOutputTimerCallback,
+		      (XtPointer) 0);
+}
+
 XtIntervalId loadGameTimerXID = 0;
 
 int
@@ -2504,6 +2524,33 @@ FrameDelay (int time)
 
 #endif
 
+static XtIntervalId frameTimerXID = 0;
+
+static void
+FrameTimerCallback (XtPointer arg, XtIntervalId *id)
+{
+    frameTimerXID = 0;
+    AnimationTick();
+}
+
+void
+StartFrameTimer (long millisec)
+{
+    frameTimerXID =
+      XtAppAddTimeOut(appContext, millisec,
+		      (XtTimerCallbackProc) FrameTimerCallback,
+		      (XtPointer) 0);
+}
+
+int
+StopFrameTimer ()
+{
+    if (frameTimerXID == 0) return FALSE;
+    XtRemoveTimeOut(frameTimerXID);
+    frameTimerXID = 0;
+    return TRUE;
+}
+
 static int
 FindLogo (char *place, char *name, char *buf)
 {   // check if file exists in given place
@@ -284,6 +284,10 @@ Show (Option *opt, int hide)
     Arg args[16];
     Dimension v;
     int j=0;
+    if(opt->type == Button && opt->handle) { // buttons simply disappear
+	XtSetMappedWhenManaged(opt->handle, !hide);
+	return;
+    }
 return; // FIXME: it would be nice if the Chat window did have an ICS pane we could hide behind
 //printf("Show(%d) %x\n", hide, opt->handle);
     if(!opt->handle) return;
@@ -298,6 +302,15 @@ printf("h = %d\n",h);
     XtSetValues(opt->handle, args, j);
 }
 
+void
+SetWidgetEditable (Option *opt, int editable)
+{
+    Arg args[1];
+    if(opt->type != TextBox || !opt->handle) return;
+    XtSetArg(args[0], XtNeditType, editable ? XawtextEdit : XawtextRead);
+    XtSetValues(opt->handle, args, 1);
+}
+
 void
 HighlightText (Option *opt, int start, int end, Boolean on)
 {
@@ -687,6 +700,16 @@ AppendText (Option *opt, char *s)
     return len;
 }
 
+void
+TruncateText (Option *opt, int from)
+{   // delete everything from the given position on
+    XawTextBlock t;
+    char *v;
+    GetWidgetText(opt, &v);
+    t.ptr = ""; t.firstPos = 0; t.length = 0; t.format = XawFmt8Bit;
+    XawTextReplace(opt->handle, from, strlen(v), &t);
+}
+
 void
 SetColor (char *colorName, Option *box)
 {       // sets the color of a widget